@@ -5,6 +5,22 @@
 #include <QFileDialog>
 #include <QtConcurrent/QtConcurrent>
 
+#include <utility>
+
+namespace
+{
+/// Jamo edited in the model, and the character of each in the font
+std::pair<JamoName, char32_t> const jamo_chars[] = {
+    { JamoName::KIYEOK, 0x3131 },  { JamoName::NIEUN, 0x3132 },
+    { JamoName::TIKEUT, 0x3133 },  { JamoName::RIEUL, 0x3134 },
+    { JamoName::MIEUM, 0x3135 },   { JamoName::PIEUP, 0x3136 },
+    { JamoName::SIOS, 0x3137 },    { JamoName::IEUNG, 0x3138 },
+    { JamoName::CIEUC, 0x3139 },   { JamoName::CHIEUCH, 0x3140 },
+    { JamoName::KHIEUHK, 0x3141 }, { JamoName::THIEUTH, 0x3142 },
+    { JamoName::PHIEUPH, 0x3143 }, { JamoName::HEIUH, 0x3144 },
+};
+}
+
 Controller::Controller(QObject* window, JamoModel* model)
     : window(window)
     , cons_model(model)
@@ -37,14 +53,20 @@ void Controller::fileImportClicked(QString file)
     QString filename = QDir::toNativeSeparators(QUrl(file).toLocalFile());
 
     load_future = QtConcurrent::run([=]() {
-        geul::Font* ptr;
+        geul::Font* ptr = nullptr;
         try
         {
             ptr = new geul::Font;
             *ptr = geul::parse_otf(filename.toLocal8Bit().constData());
+
+            // Tables and glyphs are parsed on first access, so they are
+            // accessed here for their errors to be caught
+            for (auto const& jamo : jamo_chars)
+                ptr->glyph(jamo.second);
         }
         catch (std::exception const& e)
         {
+            delete ptr;
             ptr = nullptr;
             emit alert(
                 QMessageBox::Warning,
@@ -64,20 +86,8 @@ void Controller::fileLoadFinished()
         return;
 
     loaded_font = std::move(*ptr);
-    cons_model->setGlyph(JamoName::KIYEOK, loaded_font.glyph(char32_t(0x3131)));
-    cons_model->setGlyph(JamoName::NIEUN, loaded_font.glyph(char32_t(0x3132)));
-    cons_model->setGlyph(JamoName::TIKEUT, loaded_font.glyph(char32_t(0x3133)));
-    cons_model->setGlyph(JamoName::RIEUL, loaded_font.glyph(char32_t(0x3134)));
-    cons_model->setGlyph(JamoName::MIEUM, loaded_font.glyph(char32_t(0x3135)));
-    cons_model->setGlyph(JamoName::PIEUP, loaded_font.glyph(char32_t(0x3136)));
-    cons_model->setGlyph(JamoName::SIOS, loaded_font.glyph(char32_t(0x3137)));
-    cons_model->setGlyph(JamoName::IEUNG, loaded_font.glyph(char32_t(0x3138)));
-    cons_model->setGlyph(JamoName::CIEUC, loaded_font.glyph(char32_t(0x3139)));
-    cons_model->setGlyph(JamoName::CHIEUCH, loaded_font.glyph(char32_t(0x3140)));
-    cons_model->setGlyph(JamoName::KHIEUHK, loaded_font.glyph(char32_t(0x3141)));
-    cons_model->setGlyph(JamoName::THIEUTH, loaded_font.glyph(char32_t(0x3142)));
-    cons_model->setGlyph(JamoName::PHIEUPH, loaded_font.glyph(char32_t(0x3143)));
-    cons_model->setGlyph(JamoName::HEIUH, loaded_font.glyph(char32_t(0x3144)));
+    for (auto const& jamo : jamo_chars)
+        cons_model->setGlyph(jamo.first, loaded_font.glyph(jamo.second));
 
     qDebug() << "Font load finished.";
 }
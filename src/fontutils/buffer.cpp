@@ -1,11 +1,214 @@
 #include "buffer.hpp"
 
+#include "checksum.hpp"
+
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace geul
 {
 
+// ByteSpan
+
+char const* ByteSpan::begin() const
+{
+    return data;
+}
+
+char const* ByteSpan::end() const
+{
+    return data + size;
+}
+
+std::string ByteSpan::str() const
+{
+    return std::string(data, size);
+}
+
+bool ByteSpan::operator==(ByteSpan rhs) const noexcept
+{
+    return size == rhs.size
+           && (size == 0 || std::memcmp(data, rhs.data, size) == 0);
+}
+
+// SharedBytes
+
+ByteSpan SharedBytes::span() const
+{
+    return { data.get(), size };
+}
+
+bool SharedBytes::operator==(SharedBytes const& rhs) const noexcept
+{
+    return span() == rhs.span();
+}
+
+// BufferView
+
+BufferView::BufferView(
+    char const*                 data,
+    std::size_t                 length,
+    std::shared_ptr<char const> owner,
+    std::size_t                 base)
+    : data(data)
+    , length(length)
+    , base(base)
+    , owner(std::move(owner))
+{}
+
+BufferView::BufferView(ByteSpan span)
+    : BufferView(span.data, span.size)
+{}
+
+void BufferView::report(
+    ParseError::Code code, std::string message, std::size_t pos) const
+{
+    if (!error)
+        throw std::runtime_error(message);
+
+    // keep the first error
+    if (*error)
+        return;
+    error->code = code;
+    error->offset = base + pos;
+    error->message = std::move(message);
+}
+
+void BufferView::overrun(std::size_t pos) const
+{
+    report(
+        ParseError::Code::out_of_bounds, "Attempt to read beyond buffer.", pos);
+}
+
+BufferView BufferView::report_to(ParseError* error) const
+{
+    BufferView view = *this;
+    view.error = error;
+    return view;
+}
+
+ParseError* BufferView::reported_to() const
+{
+    return error;
+}
+
+void BufferView::fail(ParseError::Code code, std::string message)
+{
+    report(code, std::move(message), cur);
+    cur = length;
+}
+
+std::string BufferView::read_string(std::size_t length)
+{
+    return read_span(length).str();
+}
+
+ByteSpan BufferView::read_span(std::size_t length)
+{
+    if (!in_bounds(cur, length))
+    {
+        fail(ParseError::Code::out_of_bounds, "cannot read string");
+        return {};
+    }
+
+    ByteSpan span{ data + cur, length };
+    cur += length;
+    return span;
+}
+
+SharedBytes BufferView::read_shared(std::size_t length)
+{
+    auto span = read_span(length);
+    if (owner && span.data)
+        return { std::shared_ptr<char const>(owner, span.data), span.size };
+
+    auto str = std::make_shared<std::string>(span.str());
+    return { std::shared_ptr<char const>(str, str->data()), span.size };
+}
+
+uint32_t BufferView::read_nint(int n)
+{
+    if (n <= 0 || n > 4)
+    {
+        fail(ParseError::Code::bad_value, "cannot read n-byte integer");
+        return 0;
+    }
+
+    uint32_t ret = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        ret <<= 8;
+        ret |= read<uint8_t>() & 0xff;
+    }
+    return ret;
+}
+
+BufferView BufferView::at(std::size_t pos) const
+{
+    BufferView view = *this;
+    view.seek(pos);
+    return view;
+}
+
+BufferView BufferView::slice(std::size_t pos, std::size_t length) const
+{
+    if (!in_bounds(pos, length))
+    {
+        report(ParseError::Code::out_of_bounds, "Slice out of bounds.", pos);
+        BufferView view = *this;
+        view.length = 0;
+        view.cur = 0;
+        return view;
+    }
+
+    BufferView view = *this;
+    view.data = data + pos;
+    view.length = length;
+    view.cur = 0;
+    view.base = base + pos;
+    return view;
+}
+
+std::size_t BufferView::seek(std::size_t pos)
+{
+    if (pos > length)
+    {
+        auto orig = cur;
+        fail(ParseError::Code::out_of_bounds, "Cannot seek to pos");
+        return orig;
+    }
+    return std::exchange(cur, pos);
+}
+
+std::size_t BufferView::input_offset() const
+{
+    return base;
+}
+
+std::size_t BufferView::tell() const
+{
+    return cur;
+}
+
+std::size_t BufferView::size() const
+{
+    return length;
+}
+
+ByteSpan BufferView::span() const
+{
+    return { data, length };
+}
+
 // InputBuffer
 
 InputBuffer InputBuffer::open(std::string filename)
@@ -21,15 +224,89 @@ InputBuffer InputBuffer::open(std::string filename)
     return input_buf;
 }
 
+InputBuffer InputBuffer::map(std::string filename)
+{
+#ifdef _WIN32
+    // No mmap, read the whole file instead
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Cannot open file");
+    std::string data{ std::istreambuf_iterator<char>(file),
+                      std::istreambuf_iterator<char>() };
+    return InputBuffer(std::move(data));
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open file");
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat file");
+    }
+
+    // mmap rejects empty mappings
+    std::size_t length = st.st_size;
+    if (length == 0)
+    {
+        ::close(fd);
+        return InputBuffer(std::string());
+    }
+
+    void* addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+        throw std::runtime_error("Cannot map file");
+
+    InputBuffer input_buf;
+    input_buf.mode = std::ios::in;
+    input_buf.storage = std::shared_ptr<char const>(
+        static_cast<char const*>(addr), [length](char const* ptr) {
+            ::munmap(const_cast<char*>(ptr), length);
+        });
+    input_buf.storage_size = length;
+
+    return input_buf;
+#endif
+}
+
 InputBuffer::InputBuffer(std::string&& data)
     : mode(std::ios::in)
-    , buf(std::make_unique<std::stringbuf>(data, mode | std::ios::binary))
 {
-    data = std::string();
+    auto str = std::make_shared<std::string>(std::move(data));
+    storage = std::shared_ptr<char const>(str, str->data());
+    storage_size = str->size();
+}
+
+bool InputBuffer::contiguous() const
+{
+    return storage != nullptr;
+}
+
+BufferView InputBuffer::view()
+{
+    if (!storage)
+    {
+        // switch to the contiguous path for good
+        auto pos = seek_begin();
+        auto str = std::make_shared<std::string>(read_string(size()));
+        storage = std::shared_ptr<char const>(str, str->data());
+        storage_size = str->size();
+        cur = pos;
+        buf.reset();
+    }
+
+    BufferView view(storage.get(), storage_size, storage);
+    view.seek(cur);
+    return view;
 }
 
 std::string InputBuffer::read_string(std::streamsize length)
 {
+    if (storage)
+        return read_span(length).str();
+
     std::string str(length, 0);
     auto        n = buf->sgetn(&str[0], length);
     if (n < length)
@@ -37,6 +314,30 @@ std::string InputBuffer::read_string(std::streamsize length)
     return str;
 }
 
+ByteSpan InputBuffer::read_span(std::size_t length)
+{
+    if (!storage)
+        throw std::runtime_error("Buffer is not contiguous.");
+    if (cur > storage_size || length > storage_size - cur)
+        throw std::runtime_error("cannot read string");
+
+    ByteSpan span{ storage.get() + cur, length };
+    cur += length;
+    return span;
+}
+
+SharedBytes InputBuffer::read_shared(std::size_t length)
+{
+    if (storage)
+    {
+        auto span = read_span(length);
+        return { std::shared_ptr<char const>(storage, span.data), length };
+    }
+
+    auto str = std::make_shared<std::string>(read_string(length));
+    return { std::shared_ptr<char const>(str, str->data()), length };
+}
+
 uint32_t InputBuffer::read_nint(int n)
 {
     if (n <= 0 || n > 4)
@@ -59,6 +360,13 @@ InputBuffer::SeekLock InputBuffer::seek_lock(std::streampos pos)
 std::streampos InputBuffer::seek(std::streampos pos)
 {
     auto orig_pos = tell();
+    if (storage)
+    {
+        if (pos < 0 || std::size_t(pos) > storage_size)
+            throw std::runtime_error("Cannot seek to pos");
+        cur = pos;
+        return orig_pos;
+    }
     if (buf->pubseekpos(pos, mode) == std::streamoff(-1))
         throw std::runtime_error("Cannot seek to pos");
     return orig_pos;
@@ -67,6 +375,11 @@ std::streampos InputBuffer::seek(std::streampos pos)
 std::streampos InputBuffer::seek_begin()
 {
     auto orig_pos = tell();
+    if (storage)
+    {
+        cur = 0;
+        return orig_pos;
+    }
     if (buf->pubseekoff(0, std::ios::beg, mode) == std::streamoff(-1))
         throw std::runtime_error("Cannot seek to the beginning of buffer.");
     return orig_pos;
@@ -75,6 +388,11 @@ std::streampos InputBuffer::seek_begin()
 std::streampos InputBuffer::seek_end()
 {
     auto orig_pos = tell();
+    if (storage)
+    {
+        cur = storage_size;
+        return orig_pos;
+    }
     if (buf->pubseekoff(0, std::ios::end, mode) == std::streamoff(-1))
         throw std::runtime_error("Cannot seek to the end of buffer.");
     return orig_pos;
@@ -82,6 +400,9 @@ std::streampos InputBuffer::seek_end()
 
 std::streampos InputBuffer::tell() const
 {
+    if (storage)
+        return cur;
+
     auto pos = buf->pubseekoff(0, std::ios::cur, mode);
     if (pos == std::streamoff(-1))
         throw std::runtime_error("Cannot tell current position.");
@@ -90,6 +411,9 @@ std::streampos InputBuffer::tell() const
 
 std::size_t InputBuffer::size() const
 {
+    if (storage)
+        return storage_size;
+
     auto orig_pos = tell();
     auto begin = buf->pubseekoff(0, std::ios::beg, mode);
     auto end = buf->pubseekoff(0, std::ios::end, mode);
@@ -99,24 +423,20 @@ std::size_t InputBuffer::size() const
 
 // OutputBuffer
 
-OutputBuffer OutputBuffer::open(std::string filename)
-{
-    OutputBuffer output_buf;
-    output_buf.mode = std::ios::in | std::ios::out;
-
-    auto buf = std::make_unique<std::filebuf>();
-    if (!buf->open(
-            filename, output_buf.mode | std::ios::binary | std::ios::trunc))
-        throw std::runtime_error("Cannot open file");
-    output_buf.buf = std::move(buf);
+OutputBuffer::OutputBuffer(std::string&& data)
+    : bytes(data.begin(), data.end())
+{}
 
-    return output_buf;
+void OutputBuffer::reserve(std::size_t capacity)
+{
+    bytes.reserve(capacity);
 }
 
-OutputBuffer::OutputBuffer(std::string&& data)
+void OutputBuffer::clear()
 {
-    mode = std::ios::in | std::ios::out;
-    buf = std::make_unique<std::stringbuf>(data, mode | std::ios::binary);
+    bytes.clear();
+    cur = 0;
+    summing = false;
 }
 
 void OutputBuffer::write_string(const std::string& str)
@@ -129,39 +449,108 @@ void OutputBuffer::write_nint(int n, uint32_t t)
     if (n <= 0 || n > 4)
         throw std::runtime_error("cannot read n-byte integer");
 
-    int      shift = (n - 1) * 8;
-    uint32_t mask = 0xff << shift;
-    for (int i = 0; i < n; ++i)
+    auto  pos = cur;
+    char* dest = claim(n);
+    for (int i = n - 1; i >= 0; --i)
     {
-        write<uint8_t>((t & mask) >> shift);
-        shift -= 8;
-        mask >>= 8;
+        dest[i] = char(t & 0xff);
+        t >>= 8;
     }
+    summed(pos, n);
+}
+
+void OutputBuffer::write_zeros(std::size_t length)
+{
+    std::fill_n(claim(length), length, 0);
 }
 
 void OutputBuffer::write_buf(InputBuffer&& other)
 {
+    if (other.storage)
+    {
+        auto rest = other.read_span(other.storage_size - other.cur);
+        write<char>(rest.data, rest.size);
+        return;
+    }
+
     constexpr auto  SIZE = 4096;
     char            arr[SIZE];
     std::streamsize n;
     do
     {
         n = other.buf->sgetn(arr, SIZE);
-        auto written = buf->sputn(arr, n);
-        if (written < n)
-            throw std::runtime_error("Cannot write to buffer");
+        write<char>(arr, n);
     } while (n == SIZE);
 }
 
 void OutputBuffer::pad()
 {
-    auto orig_pos = seek_begin();
-    auto begin = seek_end();
-    auto end = tell();
-    auto remainder = (end - begin) % 4;
-    if (remainder > 0)
-        write_nint(4 - remainder, 0);
-    seek(orig_pos);
+    bytes.resize((bytes.size() + 3) & ~std::size_t(3));
+}
+
+void OutputBuffer::begin_checksum()
+{
+    summing = true;
+    sum_begin = cur;
+    sum = checksum(bytes.data() + cur, bytes.size() - cur);
+}
+
+uint32_t OutputBuffer::end_checksum()
+{
+    summing = false;
+    return sum;
+}
+
+uint32_t OutputBuffer::sum_range(std::size_t pos, std::size_t length) const
+{
+    if (pos + length <= sum_begin)
+        return 0;
+    if (pos < sum_begin)
+    {
+        length -= sum_begin - pos;
+        pos = sum_begin;
+    }
+    return checksum(bytes.data() + pos, length, pos - sum_begin);
+}
+
+std::size_t OutputBuffer::seek(std::size_t pos)
+{
+    if (pos > bytes.size())
+        throw std::runtime_error("Cannot seek to pos");
+    return std::exchange(cur, pos);
+}
+
+std::size_t OutputBuffer::seek_end()
+{
+    return std::exchange(cur, bytes.size());
+}
+
+std::size_t OutputBuffer::tell() const
+{
+    return cur;
+}
+
+std::size_t OutputBuffer::size() const
+{
+    return bytes.size();
+}
+
+BufferView OutputBuffer::view() const
+{
+    return BufferView(bytes.data(), bytes.size());
+}
+
+void OutputBuffer::save(std::string const& filename) const
+{
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.write(bytes.data(), bytes.size()))
+        throw std::runtime_error("Cannot write to file");
+}
+
+void OutputBuffer::save(std::ostream& os) const
+{
+    if (!os.write(bytes.data(), bytes.size()))
+        throw std::runtime_error("Cannot write to stream");
 }
 
 InputBuffer::SeekLock::SeekLock(InputBuffer& buf, std::streampos orig_pos)
@@ -1,47 +1,279 @@
 #ifndef FONTUTILS_BUFFER_HPP
 #define FONTUTILS_BUFFER_HPP
 
+#include <algorithm>
 #include <ios>
+#include <iosfwd>
 #include <memory>
+#include <stdexcept>
 #include <streambuf>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "endian.hpp"
+#include "parseerror.hpp"
 
 namespace geul
 {
 class OutputBuffer;
 
+/// Non-owning view of a contiguous range of bytes
+struct ByteSpan
+{
+    char const* data = nullptr;
+    std::size_t size = 0;
+
+    char const* begin() const;
+    char const* end() const;
+    std::string str() const;
+
+    bool operator==(ByteSpan rhs) const noexcept;
+};
+
+/// Immutable bytes that share ownership of their backing storage,
+/// e.g. a range of a memory-mapped file
+struct SharedBytes
+{
+    std::shared_ptr<char const> data;
+    std::size_t                 size = 0;
+
+    ByteSpan span() const;
+
+    bool operator==(SharedBytes const& rhs) const noexcept;
+};
+
+/// Lightweight cursor over contiguous bytes.
+/// Reads go to absolute offsets and never touch shared state, so copies
+/// can be handed to nested parsers or to other threads reading the same
+/// source. Views of an InputBuffer share its storage and may outlive it;
+/// other views must not outlive the bytes they were made from.
+///
+/// Malformed input throws std::runtime_error, unless the view reports to
+/// a ParseError. Then the first error is recorded there, failed reads
+/// return zeros, and the failing view moves to its end so that reading
+/// loops stop. Views made from it share the same ParseError.
+class BufferView
+{
+    char const* data = nullptr;
+    std::size_t length = 0;
+    std::size_t cur = 0;
+
+    // Offset of `data` from the beginning of the input
+    std::size_t base = 0;
+
+    // Storage of the originating buffer, shared by read_shared()
+    std::shared_ptr<char const> owner;
+
+    // First error in non-throwing mode
+    ParseError* error = nullptr;
+
+    /// Throw, or record the error at `pos` when reporting
+    void report(
+        ParseError::Code code, std::string message, std::size_t pos) const;
+
+    /// Report a read beyond the end starting from `pos`
+    void overrun(std::size_t pos) const;
+
+    bool in_bounds(std::size_t pos, std::size_t size) const
+    {
+        return pos <= length && size <= length - pos;
+    }
+
+public:
+    BufferView() = default;
+
+    /// View of `length` bytes at `data`, which are at offset `base` of
+    /// the input
+    BufferView(
+        char const*                 data,
+        std::size_t                 length,
+        std::shared_ptr<char const> owner = nullptr,
+        std::size_t                 base = 0);
+
+    explicit BufferView(ByteSpan span);
+
+    /// Copy of this view that records errors in `error` instead of
+    /// throwing, or throws again when `error` is null
+    BufferView report_to(ParseError* error) const;
+
+    /// Where errors are recorded, or null when they are thrown
+    ParseError* reported_to() const;
+
+    /// Whether an error has been recorded
+    bool failed() const
+    {
+        return error && *error;
+    }
+
+    /// Report malformed input at the current position and move to the
+    /// end. Throws std::runtime_error unless errors are recorded.
+    void fail(ParseError::Code code, std::string message);
+
+    /// Read items starting from the absolute position `pos`
+    /// without moving the cursor
+    template <typename T>
+    void read_at(std::size_t pos, T* dest, std::size_t count) const
+    {
+        if (pos > length || count > (length - pos) / sizeof(T))
+        {
+            overrun(pos);
+            std::fill_n(dest, count, T());
+            return;
+        }
+        to_machine_endian<T>(data + pos, dest, count);
+    }
+
+    /// Convenience function for reading 1 item at `pos`
+    template <typename T> T read_at(std::size_t pos) const
+    {
+        if (!in_bounds(pos, sizeof(T)))
+        {
+            overrun(pos);
+            return T();
+        }
+        return to_machine_endian<T>(data + pos);
+    }
+
+    /// Peek items from the current position
+    template <typename T> void peek(T* dest, std::size_t count) const
+    {
+        read_at(cur, dest, count);
+    }
+
+    /// Convenience function for peeking 1 item
+    template <typename T> T peek() const
+    {
+        return read_at<T>(cur);
+    }
+
+    /// Read items from the current position, and increment position
+    template <typename T> void read(T* dest, std::size_t count)
+    {
+        if (cur > length || count > (length - cur) / sizeof(T))
+        {
+            overrun(cur);
+            cur = length;
+            std::fill_n(dest, count, T());
+            return;
+        }
+        to_machine_endian<T>(data + cur, dest, count);
+        cur += sizeof(T) * count;
+    }
+
+    /// Convenience function for reading 1 item
+    template <typename T> T read()
+    {
+        if (!in_bounds(cur, sizeof(T)))
+        {
+            overrun(cur);
+            cur = length;
+            return T();
+        }
+        T t = to_machine_endian<T>(data + cur);
+        cur += sizeof(T);
+        return t;
+    }
+
+    /// Read std::string of length `length`
+    std::string read_string(std::size_t length);
+
+    /// Read `length` bytes without copying them.
+    /// Failed reads return an empty span.
+    ByteSpan read_span(std::size_t length);
+
+    /// Read `length` bytes, sharing the storage of the originating
+    /// buffer when there is one
+    SharedBytes read_shared(std::size_t length);
+
+    /// Read n-byte integer (n = 1..4)
+    uint32_t read_nint(int n);
+
+    /// Offset of the beginning of the view from the beginning of the input
+    std::size_t input_offset() const;
+
+    /// Copy of this view positioned at `pos`
+    BufferView at(std::size_t pos) const;
+
+    /// View of `length` bytes starting from `pos`,
+    /// with offsets relative to `pos`
+    BufferView slice(std::size_t pos, std::size_t length) const;
+
+    /// Set current offset from the beginning
+    /// returns original position
+    std::size_t seek(std::size_t pos);
+
+    /// Current position in the view
+    std::size_t tell() const;
+
+    /// Size of the view
+    std::size_t size() const;
+
+    /// All bytes in the view
+    ByteSpan span() const;
+};
+
 class InputBuffer
 {
 protected:
     std::ios::openmode              mode;
     std::unique_ptr<std::streambuf> buf;
 
+    // Contiguous backing storage (a memory-mapped file or an owned string).
+    // When set, reads decode straight from memory and `buf` is unused.
+    std::shared_ptr<char const> storage;
+    std::size_t                 storage_size = 0;
+    std::size_t                 cur = 0;
+
     InputBuffer() = default;
 
+    /// Decode items from the contiguous storage starting from `pos`
+    template <typename T>
+    void decode(std::size_t pos, T* dest, std::size_t count) const
+    {
+        if (pos > storage_size || count > (storage_size - pos) / sizeof(T))
+            throw std::runtime_error("Attempt to read beyond buffer.");
+        to_machine_endian<T>(storage.get() + pos, dest, count);
+    }
+
     template <typename T> void read_impl(T* dest, std::size_t count) const
     {
-        char bytes[sizeof(T)];
-        for (auto i = 0u; i < count; ++i)
-        {
-            int n = buf->sgetn(bytes, sizeof(T));
-            if (n < int(sizeof(T)))
-                throw std::runtime_error("Attempt to read beyond buffer.");
-            dest[i] = to_machine_endian<T>(bytes);
-        }
+        // read the raw bytes in one go and convert them in place
+        auto bytes = reinterpret_cast<char*>(dest);
+        auto length = std::streamsize(sizeof(T) * count);
+        if (buf->sgetn(bytes, length) < length)
+            throw std::runtime_error("Attempt to read beyond buffer.");
+        to_machine_endian<T>(bytes, dest, count);
     }
 
     friend OutputBuffer;
 
 public:
+    /// Make a file buffer
     static InputBuffer open(std::string filename);
+
+    /// Make a buffer over a memory-mapped file
+    static InputBuffer map(std::string filename);
+
+    /// Make a buffer owning `data`
     explicit InputBuffer(std::string&& data);
 
+    /// Whether the buffer is backed by contiguous memory
+    bool contiguous() const;
+
+    /// View of the whole buffer positioned at the current position.
+    /// Streambuf-backed input buffers are read into memory first.
+    BufferView view();
+
     /// Peek items from the buffer staring from the
     /// current position
     template <typename T> void peek(T* dest, std::size_t count) const
     {
+        if (storage)
+        {
+            decode(cur, dest, count);
+            return;
+        }
         auto orig_pos = buf->pubseekoff(0, std::ios::cur, mode);
         read_impl(dest, count);
         buf->pubseekpos(orig_pos, mode);
@@ -59,6 +291,12 @@ public:
     /// current position, and increment position
     template <typename T> void read(T* dest, std::size_t count)
     {
+        if (storage)
+        {
+            decode(cur, dest, count);
+            cur += sizeof(T) * count;
+            return;
+        }
         read_impl(dest, count);
     }
 
@@ -73,6 +311,15 @@ public:
     /// Read std::string of length `length`
     std::string read_string(std::streamsize length);
 
+    /// Read `length` bytes without copying them.
+    /// Only for contiguous buffers; the span is valid
+    /// as long as the backing storage is.
+    ByteSpan read_span(std::size_t length);
+
+    /// Read `length` bytes, sharing the backing storage
+    /// instead of copying it when the buffer is contiguous
+    SharedBytes read_shared(std::size_t length);
+
     /// Read n-byte integer (n = 1..4)
     uint32_t read_nint(int n);
 
@@ -104,46 +351,98 @@ public:
     /// Current position on the stream
     std::streampos tell() const;
 
-    /// Size of the buffer for only string-backed buffers
+    /// Size of the buffer for only string-backed
+    /// or memory-mapped buffers
     std::size_t size() const;
 };
 
-class OutputBuffer : public InputBuffer
+/// Growable byte vector for writing.
+/// Writes go to the current position, which is normally the end,
+/// and placeholders are patched in place with write_at().
+class OutputBuffer
 {
-    OutputBuffer() = default;
+    std::vector<char> bytes;
+    std::size_t       cur = 0;
+
+    // Running checksum of the bytes from `sum_begin` on
+    bool        summing = false;
+    std::size_t sum_begin = 0;
+    uint32_t    sum = 0;
+
+    /// Checksum of the bytes in [pos, pos + length)
+    /// that are covered by the running checksum
+    uint32_t sum_range(std::size_t pos, std::size_t length) const;
+
+    /// Make room for `length` bytes at the current position,
+    /// and advance past them
+    char* claim(std::size_t length)
+    {
+        auto pos = cur;
+        if (summing && pos < bytes.size())
+            sum -= sum_range(pos, std::min(length, bytes.size() - pos));
+        if (length > bytes.size() - pos)
+            bytes.resize(pos + length);
+        cur += length;
+        return bytes.data() + pos;
+    }
+
+    /// Add the bytes just stored at `pos` to the running checksum
+    void summed(std::size_t pos, std::size_t length)
+    {
+        if (!summing)
+            return;
+
+        // short writes are summed inline
+        if (length <= 8 && pos >= sum_begin)
+        {
+            for (auto i = pos; i < pos + length; ++i)
+                sum += uint32_t(uint8_t(bytes[i]))
+                       << (8 * (3 - (i - sum_begin) % 4));
+        }
+        else
+            sum += sum_range(pos, length);
+    }
 
 public:
-    /// Make a file buffer
-    static OutputBuffer open(std::string filename);
+    /// Make an empty buffer
+    OutputBuffer() = default;
 
-    /// Make a string buffer
+    /// Make a buffer holding `data`, positioned at the beginning
     explicit OutputBuffer(std::string&& data);
 
+    /// Reserve capacity for `capacity` bytes in total
+    void reserve(std::size_t capacity);
+
+    /// Discard the contents, keeping the capacity
+    void clear();
+
     /// Write bytes starting from the current postion
     /// of the buffer
     template <typename T> void write(T const* ptr, std::size_t count)
     {
-        char bytes[sizeof(T)];
-        for (auto i = 0u; i < count; ++i)
-        {
-            to_big_endian<T>(bytes, ptr[i]);
-            int n = buf->sputn(bytes, sizeof(T));
-            if (n < int(sizeof(T)))
-                throw std::runtime_error("Cannot write to buffer.");
-        }
+        auto pos = cur;
+        to_big_endian<T>(claim(sizeof(T) * count), ptr, count);
+        summed(pos, sizeof(T) * count);
     }
 
     /// Convenience function for writing 1 item
     template <typename T> void write(T t)
     {
-        write(&t, 1);
+        auto pos = cur;
+        to_big_endian<T>(claim(sizeof(T)), t);
+        summed(pos, sizeof(T));
     }
 
-    /// Convenience function for writing 1 item at certain position
-    template <typename T> void write_at(std::streampos pos, T t)
+    /// Convenience function for writing 1 item at certain position.
+    /// Does not move the current position.
+    template <typename T> void write_at(std::size_t pos, T t)
     {
-        auto lock = seek_lock(pos);
-        write(t);
+        if (pos > bytes.size() || sizeof(T) > bytes.size() - pos)
+            throw std::runtime_error("Attempt to write beyond buffer.");
+        if (summing)
+            sum -= sum_range(pos, sizeof(T));
+        to_big_endian<T>(bytes.data() + pos, t);
+        summed(pos, sizeof(T));
     }
 
     /// Write string
@@ -152,11 +451,45 @@ public:
     /// Write n-byte integer (n = 1..4)
     void write_nint(int n, uint32_t t);
 
+    /// Write `length` zero bytes, usually as a placeholder
+    void write_zeros(std::size_t length);
+
     /// Write another buffer to the current pos
     void write_buf(InputBuffer&& other);
 
-    /// Pad to 4-byte boundary
+    /// Pad the end to 4-byte boundary
+    /// without moving the current position
     void pad();
+
+    /// Start a running checksum of the bytes from the current
+    /// position on, kept up to date by all later writes and patches
+    void begin_checksum();
+
+    /// Stop the running checksum and return it
+    uint32_t end_checksum();
+
+    /// Set current offset from the beginning
+    /// returns original position
+    std::size_t seek(std::size_t pos);
+
+    /// Seek to the end
+    std::size_t seek_end();
+
+    /// Current position in the buffer
+    std::size_t tell() const;
+
+    /// Number of bytes written
+    std::size_t size() const;
+
+    /// View of the written bytes.
+    /// Invalidated by writes that grow the buffer.
+    BufferView view() const;
+
+    /// Write the contents to a file
+    void save(std::string const& filename) const;
+
+    /// Write the contents to a stream
+    void save(std::ostream& os) const;
 };
 }
 
@@ -1,5 +1,7 @@
 #include "cffutils.hpp"
 
+#include <algorithm>
+#include <cstdlib>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -7,77 +9,123 @@
 namespace geul
 {
 
-IndexView parse_index(InputBuffer& dis)
+IndexView parse_index(BufferView& dis)
 {
-    std::streampos beginning = dis.tell();
-
-    int count = dis.read<uint16_t>();
+    std::size_t count = dis.read<uint16_t>();
     if (count == 0)
         return IndexView{};
 
-    int  off_size = dis.read<uint8_t>();
-    auto first_offset = dis.read_nint(off_size);
-    if (first_offset != 1)
-        throw std::runtime_error("Invalid INDEX");
+    int off_size = dis.read<uint8_t>();
+    if (off_size < 1 || off_size > 4)
+    {
+        dis.fail(ParseError::Code::bad_value, "Invalid INDEX offset size");
+        return IndexView{};
+    }
+
+    // offsets are read at once and widened to 32 bits
+    auto bytes = dis.read_span(off_size * (count + 1));
+    if (dis.failed())
+        return IndexView{};
 
-    auto offset_start = beginning + std::streamoff(2 + off_size * (count + 1));
+    std::vector<uint32_t> offsets(count + 1);
+    auto data = reinterpret_cast<uint8_t const*>(bytes.data);
+    switch (off_size)
+    {
+    case 1:
+        std::copy(data, data + offsets.size(), offsets.begin());
+        break;
+    case 2:
+    {
+        std::vector<uint16_t> narrow(offsets.size());
+        to_machine_endian<uint16_t>(bytes.data, narrow.data(), narrow.size());
+        std::copy(narrow.begin(), narrow.end(), offsets.begin());
+        break;
+    }
+    case 3:
+        for (auto& offset : offsets)
+        {
+            offset = uint32_t(data[0]) << 16 | data[1] << 8 | data[2];
+            data += 3;
+        }
+        break;
+    default:
+        to_machine_endian<uint32_t>(bytes.data, offsets.data(), offsets.size());
+    }
 
-    dis.seek(offset_start - std::streamoff(off_size - 1));
-    auto end = offset_start + std::streamoff(dis.read_nint(off_size));
-    dis.seek(end);
+    // offsets are 1-based
+    std::size_t offset_start = dis.tell() - 1;
+    if (offsets[0] != 1 || !std::is_sorted(offsets.begin(), offsets.end()))
+    {
+        dis.fail(ParseError::Code::bad_value, "Invalid INDEX");
+        return IndexView{};
+    }
+    if (offsets.back() > dis.size() - offset_start)
+    {
+        dis.fail(ParseError::Code::out_of_bounds, "INDEX data out of bounds");
+        return IndexView{};
+    }
 
-    return IndexView{ count, off_size, offset_start, &dis };
+    dis.seek(offset_start + offsets.back());
+    return IndexView(dis, offset_start, std::move(offsets));
 }
 
-IndexIterator::IndexIterator(
-    std::size_t count, int off_size, std::size_t offset_start, InputBuffer& dis)
-    : off_size(off_size)
-    , count(count)
-    , offset_start(offset_start)
-    , dis(&dis)
+IndexIterator::IndexIterator(IndexView const& view, std::size_t index)
+    : view(&view)
+    , index(index)
 {}
 
 IndexIterator& IndexIterator::operator++()
 {
-    // reached the end
-    if (++index == count)
-        dis = nullptr;
+    ++index;
     return *this;
 }
 
-bool IndexIterator::operator!=(IndexIterator& rhs) const
+bool IndexIterator::operator!=(IndexIterator const& rhs) const
 {
-    return dis != rhs.dis;
+    return index != rhs.index;
 }
 
 IndexIterator::OffsetData IndexIterator::operator*() const
 {
-    if (!dis)
+    if (!view || index >= view->size())
         throw std::runtime_error("attempt to dereference an end iterator");
 
-    std::size_t cur = offset_start + off_size * (index - count - 1) + 1;
-    auto   lock = dis->seek_lock(cur);
+    return (*view)[index];
+}
 
-    auto offset = dis->read_nint(off_size);
-    auto length = dis->read_nint(off_size) - offset;
-    offset += offset_start;
+IndexView::IndexView(
+    BufferView const&     dis,
+    std::size_t           offset_start,
+    std::vector<uint32_t> offsets)
+    : dis(dis)
+    , offset_start(offset_start)
+    , offsets(std::move(offsets))
+{}
 
-    return { offset, length, index };
+std::size_t IndexView::size() const noexcept
+{
+    return offsets.empty() ? 0 : offsets.size() - 1;
+}
+
+IndexIterator::OffsetData IndexView::operator[](std::size_t i) const
+{
+    return { offset_start + offsets[i], offsets[i + 1] - offsets[i], i };
+}
+
+ByteSpan IndexView::span(std::size_t i) const
+{
+    auto item = (*this)[i];
+    return { dis.span().data + item.pos, item.length };
 }
 
 IndexIterator IndexView::begin() const
 {
-    if (count)
-    {
-        return IndexIterator(count, off_size, offset_start, *dis);
-    }
-    else
-        return IndexIterator();
+    return IndexIterator(*this);
 }
 
 IndexIterator IndexView::end() const
 {
-    return IndexIterator();
+    return IndexIterator(*this, size());
 }
 
 CFFToken::CFFToken(Op op)
@@ -133,7 +181,7 @@ double CFFToken::to_double()
         throw std::runtime_error("type is not convertible to double");
 }
 
-CFFToken next_token(InputBuffer& dis)
+CFFToken next_token(BufferView& dis)
 {
     auto b0 = dis.read<uint8_t>() & 0xff;
     // two-byte operators
@@ -200,15 +248,24 @@ CFFToken next_token(InputBuffer& dis)
                 num += "E-";
             if (t == 0xe)
                 num += '-';
-        } while (t != 0xf);
-        return std::stod(num);
+        } while (t != 0xf && !dis.failed());
+        char*  end = nullptr;
+        double val = std::strtod(num.c_str(), &end);
+        if (num.empty() || *end != '\0')
+        {
+            dis.fail(ParseError::Code::bad_value, "invalid real number");
+            return 0;
+        }
+        return val;
     }
     else
     {
-        throw std::runtime_error("reserved token");
+        dis.fail(ParseError::Code::bad_value, "reserved token");
+        return 0;
     }
 }
 
+
 void write_index(OutputBuffer& out, int size, std::function<void(int)> cb)
 {
     auto beginning = out.tell();
@@ -220,23 +277,57 @@ void write_index(OutputBuffer& out, int size, std::function<void(int)> cb)
 
     out.write<uint8_t>(4);
 
-    auto offset_start = beginning + std::streamoff(2 + 4 * (size + 1));
-    std::streamoff offset = 1;
-    out.write<uint32_t>(offset);
+    // placeholder for offsets
+    auto offset_pos = beginning + 3;
+    out.write_zeros(4 * (size + 1));
+
+    // offsets are 1-based
+    auto offset_start = out.tell() - 1;
+    out.write_at<uint32_t>(offset_pos, 1);
     for (int i = 0; i < size; ++i)
     {
-        {
-            auto begin = offset_start + offset;
-            auto lock = out.seek_lock(begin);
-            cb(i);
-            auto len = out.tell() - begin;
-            offset += len;
-        }
+        cb(i);
+        out.write_at<uint32_t>(
+            offset_pos + 4 * (i + 1), out.tell() - offset_start);
+    }
+}
 
-        out.write<uint32_t>(offset);
+void write_index(OutputBuffer& out, std::vector<ByteSpan> const& items)
+{
+    out.write<uint16_t>(items.size());
+    if (items.empty())
+        return;
+
+    // offsets are 1-based
+    std::size_t end = 1;
+    for (auto item : items)
+        end += item.size;
+    int off_size = 1;
+    while (off_size < 4 && end >> (8 * off_size))
+        ++off_size;
+    out.write<uint8_t>(off_size);
+
+    std::vector<char> offsets((items.size() + 1) * off_size);
+    std::size_t       offset = 1;
+    for (auto i = 0u; i <= items.size(); ++i)
+    {
+        for (int b = 0; b < off_size; ++b)
+            offsets[i * off_size + b] = char(offset >> (8 * (off_size - 1 - b)));
+        if (i < items.size())
+            offset += items[i].size;
     }
+    out.write<char>(offsets.data(), offsets.size());
 
-    out.seek(offset_start + offset);
+    for (auto i = 0u; i < items.size();)
+    {
+        auto        first = items[i].data;
+        std::size_t size = 0;
+        do
+            size += items[i++].size;
+        while (i < items.size() && items[i].data == first + size);
+        if (size)
+            out.write<char>(first, size);
+    }
 }
 
 void write_token(OutputBuffer& out, CFFToken token)
@@ -327,11 +418,9 @@ void write_token(OutputBuffer& out, CFFToken token)
     }
 }
 
-void write_5byte_offset_at(OutputBuffer& out, std::streampos pos, int val)
+void write_5byte_offset_at(OutputBuffer& out, std::size_t pos, int val)
 {
-    auto orig = out.seek(pos);
-    out.write<uint8_t>(29);
-    out.write<int32_t>(val);
-    out.seek(orig);
+    out.write_at<uint8_t>(pos, 29);
+    out.write_at<int32_t>(pos + 1, val);
 }
 }
@@ -2,6 +2,7 @@
 #define FONTUTILS_CFF_UTILS_HPP
 
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <functional>
 
@@ -10,6 +11,8 @@
 namespace geul
 {
 
+class IndexView;
+
 class IndexIterator
 {
 public:
@@ -18,42 +21,61 @@ public:
 
     IndexIterator(IndexIterator const& it) = default;
 
-    IndexIterator(
-        std::size_t count, int off_size, std::size_t offset_start, InputBuffer& dis);
+    IndexIterator(IndexView const& view, std::size_t index = 0);
 
     IndexIterator& operator++();
 
-    bool operator!=(IndexIterator& rhs) const;
+    bool operator!=(IndexIterator const& rhs) const;
 
     struct OffsetData
     {
-        std::streampos pos;
+        std::size_t pos;
         std::size_t length, index;
     };
 
     OffsetData operator*() const;
 
 private:
-    std::size_t       index = 0;
-    const std::size_t off_size = 0, count = 0;
-    const std::size_t offset_start = 0;
-
-    InputBuffer* dis = nullptr;
+    IndexView const* view = nullptr;
+    std::size_t      index = 0;
 };
 
-struct IndexView
+/// An INDEX whose offsets are read once, for random access to its items
+class IndexView
 {
-    int            count = 0;
-    int            off_size;
-    std::streampos offset_start;
-    InputBuffer*   dis = nullptr;
+public:
+    /// constructs an empty INDEX
+    IndexView() = default;
+
+    /// INDEX with items starting at `offset_start` + `offsets` in `dis`
+    IndexView(
+        BufferView const&     dis,
+        std::size_t           offset_start,
+        std::vector<uint32_t> offsets);
+
+    std::size_t size() const noexcept;
+
+    /// Where item `i` is in the buffer the INDEX was read from
+    IndexIterator::OffsetData operator[](std::size_t i) const;
+
+    /// Bytes of item `i`
+    ByteSpan span(std::size_t i) const;
 
     IndexIterator begin() const;
 
     IndexIterator end() const;
+
+private:
+    BufferView  dis;
+    std::size_t offset_start = 0;
+
+    // 1-based offsets of the items and of the end of the last one
+    std::vector<uint32_t> offsets;
 };
 
-IndexView parse_index(InputBuffer& dis);
+/// Read an INDEX and move past it. Offsets that are out of order or
+/// out of bounds are malformed.
+IndexView parse_index(BufferView& dis);
 
 class CFFToken
 {
@@ -117,14 +139,18 @@ private:
     } value;
 };
 
-CFFToken next_token(InputBuffer& dis);
+CFFToken next_token(BufferView& dis);
 
 void write_index(
     OutputBuffer& out, int size, std::function<void(int)> cb);
 
+/// Write an INDEX of `items` in one pass, with offsets as wide as the
+/// data needs. Items that are stored back to back are copied at once.
+void write_index(OutputBuffer& out, std::vector<ByteSpan> const& items);
+
 void write_token(OutputBuffer& out, CFFToken token);
 
-void write_5byte_offset_at(OutputBuffer& out, std::streampos pos, int val);
+void write_5byte_offset_at(OutputBuffer& out, std::size_t pos, int val);
 } // namespace fontutils
 
 #endif
@@ -0,0 +1,123 @@
+#include "checksum.hpp"
+
+#include "endian.hpp"
+
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSSE3__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace geul
+{
+
+namespace
+{
+// Sum `count` whole words
+uint32_t sum_words(char const* data, std::size_t count)
+{
+    std::size_t i = 0;
+    uint32_t    sum = 0;
+#if defined(__AVX2__)
+    auto const mask = _mm256_setr_epi8(
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    auto acc = _mm256_setzero_si256();
+    for (; i + 8 <= count; i += 8)
+    {
+        auto v = _mm256_loadu_si256(
+            reinterpret_cast<__m256i const*>(data + i * 4));
+        acc = _mm256_add_epi32(acc, _mm256_shuffle_epi8(v, mask));
+    }
+    auto half = _mm_add_epi32(
+        _mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    alignas(16) uint32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), half);
+    sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__SSE2__)
+#if defined(__SSSE3__)
+    auto const mask
+        = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+#endif
+    auto acc = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4)
+    {
+        auto v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i * 4));
+#if defined(__SSSE3__)
+        v = _mm_shuffle_epi8(v, mask);
+#else
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+#endif
+        acc = _mm_add_epi32(acc, v);
+    }
+    alignas(16) uint32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__ARM_NEON)
+    auto acc = vdupq_n_u32(0);
+    for (; i + 4 <= count; i += 4)
+    {
+        auto v = vld1q_u8(reinterpret_cast<uint8_t const*>(data + i * 4));
+        acc = vaddq_u32(acc, vreinterpretq_u32_u8(vrev32q_u8(v)));
+    }
+    sum = vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1)
+          + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+#endif
+    for (; i < count; ++i)
+        sum += to_machine_endian<uint32_t>(data + i * 4);
+    return sum;
+}
+
+// Contribution of a single byte at `pos` within its word
+inline uint32_t byte_at(char byte, std::size_t pos)
+{
+    return uint32_t(uint8_t(byte)) << (8 * (3 - pos % 4));
+}
+}
+
+uint32_t checksum(char const* data, std::size_t length, std::size_t offset)
+{
+    uint32_t sum = 0;
+
+    // leading bytes up to the word boundary
+    for (; length > 0 && offset % 4 != 0; --length)
+        sum += byte_at(*data++, offset++);
+
+    sum += sum_words(data, length / 4);
+
+    // trailing bytes of the last word
+    data += length / 4 * 4;
+    for (std::size_t i = 0; i < length % 4; ++i)
+        sum += byte_at(data[i], i);
+
+    return sum;
+}
+
+uint64_t content_hash(char const* data, std::size_t length, uint64_t seed)
+{
+    uint64_t const prime = 0x100000001b3;
+    uint64_t       hash = (0xcbf29ce484222325 ^ seed) * prime ^ length;
+
+    // 8 bytes at a time
+    std::size_t i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    for (; i < length; ++i)
+        hash = (hash ^ uint8_t(data[i])) * prime;
+
+    // final mix, so that every input bit affects every output bit
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccd;
+    hash ^= hash >> 33;
+    return hash;
+}
+}
@@ -0,0 +1,21 @@
+#ifndef FONTUTILS_CHECKSUM_HPP
+#define FONTUTILS_CHECKSUM_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace geul
+{
+/// Sum of the big-endian uint32 words in `data`, zero-padding the
+/// last word. `offset` is the position of `data` within its first word,
+/// so that a range can be summed in several pieces.
+uint32_t checksum(char const* data, std::size_t length, std::size_t offset = 0);
+
+/// 64-bit hash of `data`, to tell blocks of bytes apart by content.
+/// Equal hashes are likely, but not certain, to mean equal bytes.
+/// Passing the hash of earlier blocks as `seed` hashes a sequence.
+uint64_t
+    content_hash(char const* data, std::size_t length, uint64_t seed = 0);
+}
+
+#endif // FONTUTILS_CHECKSUM_HPP
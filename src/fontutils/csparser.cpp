@@ -2,7 +2,8 @@
 #include "buffer.hpp"
 
 #include <algorithm>
-#include <deque>
+#include <cstdlib>
+#include <limits>
 #include <sstream>
 #include <vector>
 
@@ -30,89 +31,170 @@ enum class Op
     // clang-format on
 };
 
-bool is_number(InputBuffer const& dis)
+/// What a charstring byte starts
+enum class ByteClass : uint8_t
 {
-    auto byte = dis.peek<uint8_t>() & 0xff;
-    return byte == 28 || 32 <= byte;
+    op,        // one-byte operator
+    escape,    // two-byte operator
+    small,     // -107..+107 in one byte
+    positive,  // +108..+1131 in two bytes
+    negative,  // -1131..-108 in two bytes
+    short_int, // -32768..+32767 in three bytes
+    fixed      // 16.16 fixed point number in five bytes
+};
+
+struct ByteClasses
+{
+    ByteClass of[256];
+};
+
+constexpr ByteClasses make_byte_classes()
+{
+    ByteClasses classes{};
+    for (int b = 0; b < 256; ++b)
+    {
+        auto& c = classes.of[b];
+        if (b == 12)
+            c = ByteClass::escape;
+        else if (b == 28)
+            c = ByteClass::short_int;
+        else if (b < 32)
+            c = ByteClass::op;
+        else if (b <= 246)
+            c = ByteClass::small;
+        else if (b <= 250)
+            c = ByteClass::positive;
+        else if (b <= 254)
+            c = ByteClass::negative;
+        else
+            c = ByteClass::fixed;
+    }
+    return classes;
+}
+
+constexpr ByteClasses byte_classes = make_byte_classes();
+
+/// Operands are 16.16 fixed point numbers
+using Fixed = int32_t;
+
+constexpr Fixed to_fixed(int value)
+{
+    return value * 65536;
+}
+
+/// Nearest integer to a 16.16 fixed point number
+int round_fixed(int64_t value)
+{
+    return int((value + 0x8000) >> 16);
 }
 
-int parse_number(InputBuffer& dis)
+/// Current point, as precise as the operands that moved it
+struct Position
 {
-    auto b0 = dis.read<uint8_t>() & 0xff;
-    // -107..+107
-    if (32 <= b0 && b0 <= 246)
+    int64_t x = 0, y = 0;
+
+    Point point() const
     {
-        return b0 - 139;
+        return { round_fixed(x), round_fixed(y) };
     }
-    // +108..+1131
-    else if (247 <= b0 && b0 <= 250)
+};
+
+/// Operand stack, as deep as Type 2 charstrings allow
+class Stack
+{
+public:
+    static constexpr int capacity = 48;
+
+    int size() const
     {
-        auto b1 = dis.read<uint8_t>() & 0xff;
-        return (b0 - 247) * 256 + b1 + 108;
+        return count;
     }
-    // -1131..-108
-    else if (251 <= b0 && b0 <= 254)
+
+    bool empty() const
     {
-        auto b1 = dis.read<uint8_t>() & 0xff;
-        return -(b0 - 251) * 256 - b1 - 108;
+        return count == 0;
     }
-    // -32768..+32767
-    else if (b0 == 28)
+
+    bool full() const
     {
-        return dis.read<int16_t>();
+        return count == capacity;
     }
-    // -2^31..+2^31-1
-    else if (b0 == 255)
+
+    Fixed operator[](int i) const
     {
-        return dis.read<int32_t>();
+        return values[i];
     }
-    else
-        throw std::runtime_error("The next token is not a valid number.");
-}
 
-Op parse_op(InputBuffer& dis)
-{
-    auto b0 = dis.read<uint8_t>() & 0xff;
-    // two-byte operators
-    if (b0 == 12)
+    Fixed back() const
     {
-        auto b1 = dis.read<uint8_t>() & 0xff;
-        return Op(b0 << 8 | b1);
+        return values[count - 1];
     }
-    else if (b0 <= 11 || (13 <= b0 && b0 <= 27) || (29 <= b0 && b0 <= 31))
-        return Op(b0);
-    else
-        throw std::runtime_error("The next token is not a valid op.");
-}
 
-int get_subr_bias(int subr_count)
-{
-    int bias = 32768;
-    if (subr_count < 1240)
-        bias = 107;
-    else if (subr_count < 33900)
-        bias = 1131;
-    return bias;
-}
+    void push_back(Fixed value)
+    {
+        values[count++] = value;
+    }
+
+    void pop_back()
+    {
+        --count;
+    }
+
+    void pop_front()
+    {
+        std::copy(values + 1, values + count, values);
+        --count;
+    }
+
+    void clear()
+    {
+        count = 0;
+    }
+
+private:
+    Fixed values[capacity];
+    int   count = 0;
+};
 
 struct ParseState
 {
-    std::deque<int> stack = {};
-    Point           pos = { 0, 0 };
-    int             op_index = 0;
-    Glyph           glyph = {};
-    int             n_hints = 0;
-    bool            finished = false;
+    Stack       stack = {};
+    Position    pos = {};
+    int         op_index = 0;
+    Glyph       glyph = {};
+    int         n_hints = 0;
+    int         depth = 0;
+    bool        finished = false;
+    ParseError* error = nullptr;
 };
 
+// Type 2 charstrings nest subroutines at most 10 deep
+constexpr int max_subr_depth = 10;
+
 void call_subroutine(
-    std::string                     cs,
-    std::vector<std::string> const& gsubrs,
-    std::vector<std::string> const& lsubrs,
-    int                             nominal_width,
-    ParseState&                     state)
+    ByteSpan                     cs,
+    std::vector<ByteSpan> const& gsubrs,
+    std::vector<ByteSpan> const& lsubrs,
+    int                          nominal_width,
+    ParseState&                  state)
 {
-    InputBuffer buf(std::move(cs));
+    auto const* bytes = reinterpret_cast<uint8_t const*>(cs.data);
+    std::size_t cur = 0;
+
+    // errors are reported where the token that caused them starts
+    std::size_t token = 0;
+    auto        report = [&](ParseError::Code code, std::string message) {
+        auto buf = BufferView(cs).report_to(state.error);
+        buf.seek(token);
+        buf.fail(code, std::move(message));
+    };
+    auto fail = [&](std::string message) {
+        report(ParseError::Code::bad_charstring, std::move(message));
+    };
+    auto overrun = [&] {
+        report(
+            ParseError::Code::out_of_bounds, "Attempt to read beyond buffer.");
+    };
 
     auto& stack = state.stack;
     auto& pos = state.pos;
@@ -120,14 +202,68 @@ void call_subroutine(
 
     while (!state.finished)
     {
-        if (is_number(buf))
+        token = cur;
+        if (cur == cs.size)
+            return overrun();
+
+        // operands are pushed, operators fall through to be run
+        auto b0 = bytes[cur];
+        auto op = Op(b0);
+        switch (byte_classes.of[b0])
         {
-            stack.push_back(parse_number(buf));
+        case ByteClass::op:
+            cur += 1;
+            break;
+        case ByteClass::escape:
+            if (cs.size - cur < 2)
+                return overrun();
+            op = Op(b0 << 8 | bytes[cur + 1]);
+            cur += 2;
+            break;
+        case ByteClass::small:
+            if (stack.full())
+                return fail("operand stack overflow");
+            stack.push_back(to_fixed(b0 - 139));
+            cur += 1;
+            continue;
+        case ByteClass::positive:
+            if (cs.size - cur < 2)
+                return overrun();
+            if (stack.full())
+                return fail("operand stack overflow");
+            stack.push_back(to_fixed((b0 - 247) * 256 + bytes[cur + 1] + 108));
+            cur += 2;
+            continue;
+        case ByteClass::negative:
+            if (cs.size - cur < 2)
+                return overrun();
+            if (stack.full())
+                return fail("operand stack overflow");
+            stack.push_back(
+                to_fixed(-(b0 - 251) * 256 - bytes[cur + 1] - 108));
+            cur += 2;
+            continue;
+        case ByteClass::short_int:
+            if (cs.size - cur < 3)
+                return overrun();
+            if (stack.full())
+                return fail("operand stack overflow");
+            stack.push_back(
+                to_fixed(int16_t(bytes[cur + 1] << 8 | bytes[cur + 2])));
+            cur += 3;
+            continue;
+        case ByteClass::fixed:
+            if (cs.size - cur < 5)
+                return overrun();
+            if (stack.full())
+                return fail("operand stack overflow");
+            stack.push_back(Fixed(
+                uint32_t(bytes[cur + 1]) << 24 | bytes[cur + 2] << 16
+                | bytes[cur + 3] << 8 | bytes[cur + 4]));
+            cur += 5;
             continue;
         }
 
-        Op op = parse_op(buf);
-
         if (state.op_index == 0)
         {
             bool is_even_op = op == Op::hstem || op == Op::hstemhm
@@ -141,147 +277,149 @@ void call_subroutine(
                               || op == Op::callgsubr || op == Op::return_;
 
             if (!is_even_op && !one_arg_op && !is_subr_op)
-                throw std::runtime_error("Invalid first operator.");
+                return fail("Invalid first operator.");
 
             if ((stack.size() % 2 == 1 && is_even_op)
                 || (stack.size() == 2 && one_arg_op))
             {
-                glyph.width = nominal_width + stack[0];
+                glyph.width = nominal_width + round_fixed(stack[0]);
                 stack.pop_front();
             }
         }
 
-        if (op == Op::rmoveto)
+        switch (op)
+        {
+        case Op::rmoveto:
         {
             if (stack.size() != 2)
             {
                 std::ostringstream os;
                 os << "incorrect number of arguments for rmoveto: "
                    << stack.size();
-                throw std::invalid_argument(os.str());
+                return fail(os.str());
             }
 
             pos.x += stack[0];
             pos.y += stack[1];
-            glyph.paths.emplace_back(pos);
+            glyph.paths.emplace_back(pos.point());
             stack.clear();
+            break;
         }
-        else if (op == Op::hmoveto)
+        case Op::hmoveto:
         {
             if (stack.size() != 1)
-                throw std::invalid_argument(
-                    "incorrect number of arguments for hmoveto");
+                return fail("incorrect number of arguments for hmoveto");
 
             pos.x += stack[0];
-            glyph.paths.emplace_back(pos);
+            glyph.paths.emplace_back(pos.point());
             stack.clear();
+            break;
         }
-        else if (op == Op::vmoveto)
+        case Op::vmoveto:
         {
             if (stack.size() != 1)
-                throw std::invalid_argument(
-                    "incorrect number of arguments for vmoveto");
+                return fail("incorrect number of arguments for vmoveto");
 
             pos.y += stack[0];
-            glyph.paths.emplace_back(pos);
+            glyph.paths.emplace_back(pos.point());
             stack.clear();
+            break;
         }
-        else if (op == Op::rlineto)
+        case Op::rlineto:
         {
             if (glyph.paths.empty())
-                glyph.paths.emplace_back(pos);
+                glyph.paths.emplace_back(pos.point());
 
             if (stack.empty() || stack.size() % 2)
-                throw std::invalid_argument(
-                    "incorrect number of arguments for rlineto");
+                return fail("incorrect number of arguments for rlineto");
 
             // lines
-            for (int i = 0; i < int(stack.size()); i += 2)
+            for (int i = 0; i < stack.size(); i += 2)
             {
                 pos.x += stack[i], pos.y += stack[i + 1];
-                glyph.paths.back().lineto(pos);
+                glyph.paths.back().lineto(pos.point());
             }
             stack.clear();
+            break;
         }
-        else if (op == Op::hlineto)
+        case Op::hlineto:
         {
             if (glyph.paths.empty())
-                glyph.paths.push_back(Path(pos));
+                glyph.paths.push_back(Path(pos.point()));
 
             if (stack.empty())
-                throw std::invalid_argument(
-                    "incorrect number of arguments for hlineto");
+                return fail("incorrect number of arguments for hlineto");
 
             // alternating horizontal/vertical lines
-            for (int i = 0; i < int(stack.size()); i += 2)
+            for (int i = 0; i < stack.size(); i += 2)
             {
                 // horizontal line
                 pos.x += stack[i];
-                glyph.paths.back().lineto(pos);
+                glyph.paths.back().lineto(pos.point());
 
                 // vertical line
-                if (i + 1 < int(stack.size()))
+                if (i + 1 < stack.size())
                 {
                     pos.y += stack[i + 1];
-                    glyph.paths.back().lineto(pos);
+                    glyph.paths.back().lineto(pos.point());
                 }
             }
             stack.clear();
+            break;
         }
-        else if (op == Op::vlineto)
+        case Op::vlineto:
         {
             if (glyph.paths.empty())
-                glyph.paths.push_back(Path(pos));
+                glyph.paths.push_back(Path(pos.point()));
 
             if (stack.empty())
-                throw std::invalid_argument(
-                    "incorrect number of arguments for vlineto");
+                return fail("incorrect number of arguments for vlineto");
 
             // alternating vertical/horizontal lines
-            for (int i = 0; i < int(stack.size()); i += 2)
+            for (int i = 0; i < stack.size(); i += 2)
             {
                 // vertical line
                 pos.y += stack[i];
-                glyph.paths.back().lineto(pos);
+                glyph.paths.back().lineto(pos.point());
 
                 // horizontal line
-                if (i + 1 < int(stack.size()))
+                if (i + 1 < stack.size())
                 {
                     pos.x += stack[i + 1];
-                    glyph.paths.back().lineto(pos);
+                    glyph.paths.back().lineto(pos.point());
                 }
             }
             stack.clear();
+            break;
         }
-        else if (op == Op::rrcurveto)
+        case Op::rrcurveto:
         {
             if (glyph.paths.empty())
-                glyph.paths.push_back(Path(pos));
+                glyph.paths.push_back(Path(pos.point()));
 
             if (stack.empty() || stack.size() % 6)
-                throw std::invalid_argument(
-                    "incorrect number of arguments for rrcurveto");
+                return fail("incorrect number of arguments for rrcurveto");
 
             // Bezier curves
-            for (int i = 0; i < int(stack.size()); i += 6)
+            for (int i = 0; i < stack.size(); i += 6)
             {
                 pos.x += stack[i], pos.y += stack[i + 1];
-                Point ct1 = pos;
+                Point ct1 = pos.point();
                 pos.x += stack[i + 2], pos.y += stack[i + 3];
-                Point ct2 = pos;
+                Point ct2 = pos.point();
                 pos.x += stack[i + 4], pos.y += stack[i + 5];
-                glyph.paths.back().curveto(ct1, ct2, pos);
+                glyph.paths.back().curveto(ct1, ct2, pos.point());
             }
             stack.clear();
+            break;
         }
-        else if (op == Op::hhcurveto)
+        case Op::hhcurveto:
         {
             if (glyph.paths.empty())
-                glyph.paths.push_back(Path(pos));
+                glyph.paths.push_back(Path(pos.point()));
 
             if (stack.empty() || stack.size() % 4 > 1)
-                throw std::invalid_argument(
-                    "invalid number of arguments for hhcurveto");
+                return fail("invalid number of arguments for hhcurveto");
 
             if (stack.size() % 4 == 1)
             {
@@ -289,160 +427,160 @@ void call_subroutine(
                 stack.pop_front();
             }
 
-            for (int i = 0; i < int(stack.size()); i += 4)
+            for (int i = 0; i < stack.size(); i += 4)
             {
                 pos.x += stack[i];
-                Point ct1 = pos;
+                Point ct1 = pos.point();
                 pos.x += stack[i + 1], pos.y += stack[i + 2];
-                Point ct2 = pos;
+                Point ct2 = pos.point();
                 pos.x += stack[i + 3];
-                glyph.paths.back().curveto(ct1, ct2, pos);
+                glyph.paths.back().curveto(ct1, ct2, pos.point());
             }
             stack.clear();
+            break;
         }
-        else if (op == Op::hvcurveto)
+        case Op::hvcurveto:
         {
             if (glyph.paths.empty())
-                glyph.paths.push_back(Path(pos));
+                glyph.paths.push_back(Path(pos.point()));
 
             if (stack.empty()
                 || (stack.size() % 8 != 0 && stack.size() % 8 != 1
                     && stack.size() % 8 != 4 && stack.size() % 8 != 5))
-                throw std::invalid_argument(
-                    "invalid number of arguments for hvcurveto");
+                return fail("invalid number of arguments for hvcurveto");
 
             // alternate start horizontal, end vertical and
             // start vertical, end horizontal
-            for (int i = 0; i + 1 < int(stack.size()); i += 8)
+            for (int i = 0; i + 1 < stack.size(); i += 8)
             {
                 pos.x += stack[i];
-                Point ct1 = pos;
+                Point ct1 = pos.point();
                 pos.x += stack[i + 1], pos.y += stack[i + 2];
-                Point ct2 = pos;
+                Point ct2 = pos.point();
                 pos.y += stack[i + 3];
-                if (i + 5 == int(stack.size()))
+                if (i + 5 == stack.size())
                     pos.x += stack[i + 4];
-                glyph.paths.back().curveto(ct1, ct2, pos);
+                glyph.paths.back().curveto(ct1, ct2, pos.point());
 
-                if (int(stack.size()) < i + 8)
+                if (stack.size() < i + 8)
                     break;
 
                 pos.y += stack[i + 4];
-                ct1 = pos;
+                ct1 = pos.point();
                 pos.x += stack[i + 5], pos.y += stack[i + 6];
-                ct2 = pos;
+                ct2 = pos.point();
                 pos.x += stack[i + 7];
-                if (i + 9 == int(stack.size()))
+                if (i + 9 == stack.size())
                     pos.y += stack[i + 8];
-                glyph.paths.back().curveto(ct1, ct2, pos);
+                glyph.paths.back().curveto(ct1, ct2, pos.point());
             }
 
             stack.clear();
+            break;
         }
-        else if (op == Op::rcurveline)
+        case Op::rcurveline:
         {
             if (glyph.paths.empty())
-                glyph.paths.push_back(Path(pos));
+                glyph.paths.push_back(Path(pos.point()));
 
             if (stack.size() % 6 != 2)
-                throw std::invalid_argument(
-                    "invalid number of arguments for rcurveline");
+                return fail("invalid number of arguments for rcurveline");
 
             // Bezier curves
-            for (int i = 0; i < int(stack.size()) - 2; i += 6)
+            for (int i = 0; i < stack.size() - 2; i += 6)
             {
                 pos.x += stack[i], pos.y += stack[i + 1];
-                Point ct1 = pos;
+                Point ct1 = pos.point();
                 pos.x += stack[i + 2], pos.y += stack[i + 3];
-                Point ct2 = pos;
+                Point ct2 = pos.point();
                 pos.x += stack[i + 4], pos.y += stack[i + 5];
-                glyph.paths.back().curveto(ct1, ct2, pos);
+                glyph.paths.back().curveto(ct1, ct2, pos.point());
             }
 
             // followed by a line
             pos.x += stack[stack.size() - 2];
             pos.y += stack[stack.size() - 1];
-            glyph.paths.back().lineto(pos);
+            glyph.paths.back().lineto(pos.point());
 
             stack.clear();
+            break;
         }
-        else if (op == Op::rlinecurve)
+        case Op::rlinecurve:
         {
             if (glyph.paths.empty())
-                glyph.paths.push_back(Path(pos));
+                glyph.paths.push_back(Path(pos.point()));
 
             if (stack.size() < 8 || stack.size() % 2)
-                throw std::invalid_argument(
-                    "invalid number of arguments for rlinecurve");
+                return fail("invalid number of arguments for rlinecurve");
 
             // lines
-            for (int i = 0; i < int(stack.size()) - 6; i += 2)
+            for (int i = 0; i < stack.size() - 6; i += 2)
             {
                 pos.x += stack[i], pos.y += stack[i + 1];
-                glyph.paths.back().lineto(pos);
+                glyph.paths.back().lineto(pos.point());
             }
 
             // followed by a curve
             pos.x += stack[stack.size() - 6];
             pos.y += stack[stack.size() - 5];
-            Point ct1 = pos;
+            Point ct1 = pos.point();
             pos.x += stack[stack.size() - 4];
             pos.y += stack[stack.size() - 3];
-            Point ct2 = pos;
+            Point ct2 = pos.point();
             pos.x += stack[stack.size() - 2];
             pos.y += stack[stack.size() - 1];
-            glyph.paths.back().curveto(ct1, ct2, pos);
+            glyph.paths.back().curveto(ct1, ct2, pos.point());
 
             stack.clear();
+            break;
         }
-        else if (op == Op::vhcurveto)
+        case Op::vhcurveto:
         {
             if (glyph.paths.empty())
-                glyph.paths.push_back(Path(pos));
+                glyph.paths.push_back(Path(pos.point()));
 
             if (stack.empty()
                 || (stack.size() % 8 != 0 && stack.size() % 8 != 1
                     && stack.size() % 8 != 4 && stack.size() % 8 != 5))
-                throw std::invalid_argument(
-                    "invalid number of arguments for vhcurveto");
+                return fail("invalid number of arguments for vhcurveto");
 
             // alternate start vertical, end horizontal and
             // start horizontal, end vertical
-            for (int i = 0; i + 1 < int(stack.size()); i += 8)
+            for (int i = 0; i + 1 < stack.size(); i += 8)
             {
                 pos.y += stack[i];
-                Point ct1 = pos;
+                Point ct1 = pos.point();
                 pos.x += stack[i + 1], pos.y += stack[i + 2];
-                Point ct2 = pos;
+                Point ct2 = pos.point();
                 pos.x += stack[i + 3];
-                if (i + 5 == int(stack.size()))
+                if (i + 5 == stack.size())
                     pos.y += stack[i + 4];
-                glyph.paths.back().curveto(ct1, ct2, pos);
+                glyph.paths.back().curveto(ct1, ct2, pos.point());
 
-                if (int(stack.size()) < i + 8)
+                if (stack.size() < i + 8)
                     break;
 
                 pos.x += stack[i + 4];
-                ct1 = pos;
+                ct1 = pos.point();
                 pos.x += stack[i + 5], pos.y += stack[i + 6];
-                ct2 = pos;
+                ct2 = pos.point();
                 pos.y += stack[i + 7];
-                if (i + 9 == int(stack.size()))
+                if (i + 9 == stack.size())
                     pos.x += stack[i + 8];
-                glyph.paths.back().curveto(ct1, ct2, pos);
+                glyph.paths.back().curveto(ct1, ct2, pos.point());
             }
 
             stack.clear();
+            break;
         }
-        else if (op == Op::vvcurveto)
+        case Op::vvcurveto:
         {
             if (glyph.paths.empty())
-                glyph.paths.push_back(Path(pos));
+                glyph.paths.push_back(Path(pos.point()));
 
             if (stack.empty()
                 || (stack.size() % 4 != 0 && stack.size() % 4 != 1))
-                throw std::invalid_argument(
-                    "invalid number of arguments for vvcurveto");
+                return fail("invalid number of arguments for vvcurveto");
 
             int i = 0;
             if (stack.size() % 4 == 1)
@@ -451,245 +589,291 @@ void call_subroutine(
                 ++i;
             }
 
-            for (; i < int(stack.size()); i += 4)
+            for (; i < stack.size(); i += 4)
             {
                 pos.y += stack[i];
-                Point ct1 = pos;
+                Point ct1 = pos.point();
                 pos.x += stack[i + 1], pos.y += stack[i + 2];
-                Point ct2 = pos;
+                Point ct2 = pos.point();
                 pos.y += stack[i + 3];
-                glyph.paths.back().curveto(ct1, ct2, pos);
+                glyph.paths.back().curveto(ct1, ct2, pos.point());
             }
 
             stack.clear();
+            break;
         }
-        else if (op == Op::flex)
+        case Op::flex:
         {
             if (glyph.paths.empty())
-                glyph.paths.push_back(Path(pos));
+                glyph.paths.push_back(Path(pos.point()));
 
             if (stack.size() != 13)
-                std::invalid_argument("invalid number of arguments for flex");
+                return fail("invalid number of arguments for flex");
 
-            for (int i = 0; i < int(stack.size()) - 1; i += 6)
+            for (int i = 0; i < stack.size() - 1; i += 6)
             {
                 pos.x += stack[i], pos.y += stack[i + 1];
-                Point ct1 = pos;
+                Point ct1 = pos.point();
                 pos.x += stack[i + 2];
                 pos.y += stack[i + 3];
-                Point ct2 = pos;
+                Point ct2 = pos.point();
                 pos.x += stack[i + 4];
                 pos.y += stack[i + 5];
-                glyph.paths.back().curveto(ct1, ct2, pos);
+                glyph.paths.back().curveto(ct1, ct2, pos.point());
             }
 
             // TODO: take care of "flex depth"
 
             stack.clear();
+            break;
         }
-        else if (op == Op::hflex)
+        case Op::hflex:
         {
             if (glyph.paths.empty())
-                glyph.paths.push_back(Path(pos));
+                glyph.paths.push_back(Path(pos.point()));
 
             if (stack.size() != 7)
-                std::invalid_argument("invalid number of arguments for hflex");
+                return fail("invalid number of arguments for hflex");
 
-            Point orig = pos;
+            auto orig = pos;
 
             pos.x += stack[0];
-            Point ct1 = pos;
+            Point ct1 = pos.point();
             pos.x += stack[1], pos.y += stack[2];
-            Point ct2 = pos;
+            Point ct2 = pos.point();
             pos.x += stack[3];
-            glyph.paths.back().curveto(ct1, ct2, pos);
+            glyph.paths.back().curveto(ct1, ct2, pos.point());
 
             pos.x += stack[4];
-            ct1 = pos;
+            ct1 = pos.point();
             pos.x += stack[5], pos.y = orig.y;
-            ct2 = pos;
+            ct2 = pos.point();
             pos.x += stack[6];
-            glyph.paths.back().curveto(ct1, ct2, pos);
+            glyph.paths.back().curveto(ct1, ct2, pos.point());
 
             // TODO: fd = 50
 
             stack.clear();
+            break;
         }
-        else if (op == Op::hflex1)
+        case Op::hflex1:
         {
             if (glyph.paths.empty())
-                glyph.paths.push_back(Path(pos));
+                glyph.paths.push_back(Path(pos.point()));
 
             if (stack.size() != 9)
-                std::invalid_argument("invalid number of arguments for hflex1");
+                return fail("invalid number of arguments for hflex1");
 
-            Point orig = pos;
+            auto orig = pos;
 
             pos.x += stack[0], pos.y += stack[1];
-            Point ct1 = pos;
+            Point ct1 = pos.point();
             pos.x += stack[2];
             pos.y += stack[3];
-            Point ct2 = pos;
+            Point ct2 = pos.point();
             pos.x += stack[4];
-            glyph.paths.back().curveto(ct1, ct2, pos);
+            glyph.paths.back().curveto(ct1, ct2, pos.point());
 
             pos.x += stack[5];
-            ct1 = pos;
+            ct1 = pos.point();
             pos.x += stack[6], pos.y = orig.y;
-            ct2 = pos;
-            glyph.paths.back().curveto(ct1, ct2, pos);
+            ct2 = pos.point();
+            glyph.paths.back().curveto(ct1, ct2, pos.point());
 
             // TODO: fd = 50
 
             stack.clear();
+            break;
         }
-        else if (op == Op::flex1)
+        case Op::flex1:
         {
             if (glyph.paths.empty())
-                glyph.paths.push_back(Path(pos));
+                glyph.paths.push_back(Path(pos.point()));
 
             if (stack.size() != 11)
-                throw std::invalid_argument(
-                    "invalid number of arguments for flex1");
+                return fail("invalid number of arguments for flex1");
 
-            Point orig = pos;
+            auto orig = pos;
 
             pos.x += stack[0], pos.y += stack[1];
-            Point ct1 = pos;
+            Point ct1 = pos.point();
             pos.x += stack[2], pos.y += stack[3];
-            Point ct2 = pos;
+            Point ct2 = pos.point();
             pos.x += stack[4], pos.y += stack[5];
-            glyph.paths.back().curveto(ct1, ct2, pos);
+            glyph.paths.back().curveto(ct1, ct2, pos.point());
 
             pos.x += stack[6], pos.y += stack[7];
-            ct1 = pos;
+            ct1 = pos.point();
             pos.x += stack[8], pos.y += stack[9];
-            ct2 = pos;
+            ct2 = pos.point();
 
             if (std::abs(pos.x - orig.x) > std::abs(pos.y - orig.y))
                 pos.x += stack[10], pos.y = orig.y;
             else
                 pos.x = orig.x, pos.y += stack[10];
-            glyph.paths.back().curveto(ct1, ct2, pos);
+            glyph.paths.back().curveto(ct1, ct2, pos.point());
 
             // TODO: fd = 50
 
             stack.clear();
+            break;
         }
-        else if (op == Op::endchar)
+        case Op::endchar:
         {
             if (!stack.empty())
-                throw std::invalid_argument(
-                    "stack not empty when finishing glyph");
+                return fail("stack not empty when finishing glyph");
             state.finished = true;
             break;
         }
-        else if (op == Op::hstem)
+        case Op::hstem:
         {
             if (stack.size() % 2 == 1)
-                throw std::invalid_argument(
-                    "invalid number of arguments for hstem");
+                return fail("invalid number of arguments for hstem");
             state.n_hints += stack.size() / 2;
             stack.clear();
+            break;
         }
-        else if (op == Op::vstem)
+        case Op::vstem:
         {
             if (stack.size() % 2 == 1)
-                throw std::invalid_argument(
-                    "invalid number of arguments for vstem");
+                return fail("invalid number of arguments for vstem");
             state.n_hints += stack.size() / 2;
             stack.clear();
+            break;
         }
-        else if (op == Op::hstemhm)
+        case Op::hstemhm:
         {
             if (stack.size() % 2 == 1)
-                throw std::invalid_argument(
-                    "invalid number of arguments for hstemhm");
+                return fail("invalid number of arguments for hstemhm");
             state.n_hints += stack.size() / 2;
             stack.clear();
+            break;
         }
-        else if (op == Op::vstemhm)
+        case Op::vstemhm:
         {
             if (stack.size() % 2 == 1)
-                throw std::invalid_argument(
-                    "invalid number of arguments for vstemhm");
+                return fail("invalid number of arguments for vstemhm");
             state.n_hints += stack.size() / 2;
             stack.clear();
+            break;
         }
-        else if (op == Op::hintmask)
+        case Op::hintmask:
         {
             // arguments for omitted vstem op
             if (stack.size() % 2 == 1)
-                throw std::invalid_argument(
-                    "invalid number of arguments for hintmask");
+                return fail("invalid number of arguments for hintmask");
             state.n_hints += stack.size() / 2;
 
-            // read mask
-            int n_bytes = (state.n_hints + 7) / 8;
-            for (int i = 0; i < n_bytes; ++i)
-                buf.read<uint8_t>();
+            // skip mask
+            std::size_t n_bytes = (state.n_hints + 7) / 8;
+            if (cs.size - cur < n_bytes)
+                return overrun();
+            cur += n_bytes;
             stack.clear();
+            break;
         }
-        else if (op == Op::cntrmask)
+        case Op::cntrmask:
         {
             // arguments for omitted vstem op
             if (stack.size() % 2 == 1)
-                throw std::invalid_argument(
-                    "invalid number of arguments for cntrmask");
+                return fail("invalid number of arguments for cntrmask");
             state.n_hints += stack.size() / 2;
 
-            // read mask
-            int n_bytes = (state.n_hints + 7) / 8;
-            for (int i = 0; i < n_bytes; ++i)
-                buf.read<uint8_t>();
+            // skip mask
+            std::size_t n_bytes = (state.n_hints + 7) / 8;
+            if (cs.size - cur < n_bytes)
+                return overrun();
+            cur += n_bytes;
             stack.clear();
+            break;
         }
-        else if (op == Op::callgsubr)
-        {
-            std::size_t idx = stack.back() + get_subr_bias(gsubrs.size());
-            stack.pop_back();
-            if (idx >= gsubrs.size())
-                throw std::invalid_argument("gsubr index out of bounds");
-            call_subroutine(gsubrs[idx], gsubrs, lsubrs, nominal_width, state);
-            continue;
-        }
-        else if (op == Op::callsubr)
+        case Op::callgsubr:
+        case Op::callsubr:
         {
-            std::size_t idx = stack.back() + get_subr_bias(lsubrs.size());
+            auto const& subrs = op == Op::callgsubr ? gsubrs : lsubrs;
+            if (stack.empty())
+                return fail("missing subroutine index");
+            if (state.depth == max_subr_depth)
+                return fail("subroutines nested too deep");
+
+            std::size_t idx
+                = round_fixed(stack.back()) + subr_bias(subrs.size());
             stack.pop_back();
-            if (idx >= lsubrs.size())
-                throw std::invalid_argument("lsubr index out of bounds");
-            call_subroutine(lsubrs[idx], gsubrs, lsubrs, nominal_width, state);
+            if (idx >= subrs.size())
+                return fail("subroutine index out of bounds");
+
+            state.depth++;
+            call_subroutine(subrs[idx], gsubrs, lsubrs, nominal_width, state);
+            state.depth--;
+            if (state.error && *state.error)
+                return;
             continue;
         }
-        else if (op == Op::return_)
-        {
-            break;
-        }
-        else
-        {
-            throw std::runtime_error("Unimplemented operator");
+        case Op::return_:
+            return;
+        default:
+            return fail("Unimplemented operator");
         }
         state.op_index++;
     }
 }
 }
 
+int subr_bias(std::size_t subr_count)
+{
+    int bias = 32768;
+    if (subr_count < 1240)
+        bias = 107;
+    else if (subr_count < 33900)
+        bias = 1131;
+    return bias;
+}
+
 Glyph parse_charstring(
-    std::string const&              cs,
-    std::vector<std::string> const& gsubrs,
-    std::vector<std::string> const& lsubrs,
-    int                             default_width,
-    int                             nominal_width)
+    ByteSpan                     cs,
+    std::vector<ByteSpan> const& gsubrs,
+    std::vector<ByteSpan> const& lsubrs,
+    int                          default_width,
+    int                          nominal_width,
+    ParseError*                  error)
 {
     ParseState state;
     state.glyph.width = default_width;
+    state.error = error;
     call_subroutine(cs, gsubrs, lsubrs, nominal_width, state);
     if (!state.finished)
-        throw std::runtime_error("premature end of charstring parsing");
+    {
+        BufferView(cs).report_to(error).fail(
+            ParseError::Code::bad_charstring,
+            "premature end of charstring parsing");
+    }
     return state.glyph;
 }
 
+Glyph parse_charstring(
+    std::string const&              cs,
+    std::vector<std::string> const& gsubrs,
+    std::vector<std::string> const& lsubrs,
+    int                             default_width,
+    int                             nominal_width,
+    ParseError*                     error)
+{
+    auto spans = [](std::vector<std::string> const& subrs) {
+        std::vector<ByteSpan> items;
+        items.reserve(subrs.size());
+        for (auto const& subr : subrs)
+            items.push_back(ByteSpan{ subr.data(), subr.size() });
+        return items;
+    };
+    return parse_charstring(
+        ByteSpan{ cs.data(), cs.size() },
+        spans(gsubrs),
+        spans(lsubrs),
+        default_width,
+        nominal_width,
+        error);
+}
+
 namespace
 {
 void write_number(OutputBuffer& out, int val)
@@ -728,43 +912,308 @@ void write_op(OutputBuffer& out, Op op)
     else
         out.write<uint8_t>(int_op);
 }
+
+/// Bytes write_number() takes for `val`
+int number_size(int val)
+{
+    if (-107 <= val && val <= 107)
+        return 1;
+    if (-1131 <= val && val <= 1131)
+        return 2;
+    if (-32768 <= val && val <= 32767)
+        return 3;
+    return 5;
 }
 
-void write_charstring(OutputBuffer& out, Glyph const& glyph)
+// Operands an operator takes at most. One short of what the stack holds,
+// so that charstrings still fit once a subroutine number is pushed in
+// the middle of them.
+constexpr int max_args = Stack::capacity - 1;
+
+/// Segment relative to where it starts: dx and dy of a line, or
+/// dxa dya dxb dyb dxc dyc of a curve
+struct Delta
+{
+    bool line;
+    int  d[6];
+
+    int cost() const
+    {
+        int cost = 0;
+        for (int i = 0; i < (line ? 2 : 6); ++i)
+            cost += number_size(d[i]);
+        return cost;
+    }
+};
+
+/// Segments written by one operator, ending where the next run begins
+struct Run
+{
+    Op          op;
+    std::size_t begin;
+};
+
+/// Runs that write `segs` in the fewest bytes, found by trying every
+/// operator from every segment on as far as it reaches
+std::vector<Run> plan_runs(std::vector<Delta> const& segs)
+{
+    auto const       n = segs.size();
+    std::vector<int> best(n + 1, std::numeric_limits<int>::max());
+    std::vector<Run> last(n + 1);
+    best[0] = 0;
+
+    // `end` is reached from `begin` by `op` with operands of `cost` bytes
+    auto offer = [&](std::size_t begin, std::size_t end, Op op, int cost) {
+        cost += best[begin] + 1;
+        if (cost < best[end])
+        {
+            best[end] = cost;
+            last[end] = { op, begin };
+        }
+    };
+
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        // rlineto, and rlinecurve when a curve follows the lines
+        int cost = 0;
+        for (auto j = i; j < n && segs[j].line; ++j)
+        {
+            int num_args = 2 * (j - i + 1);
+            if (num_args > max_args)
+                break;
+            cost += segs[j].cost();
+            offer(i, j + 1, Op::rlineto, cost);
+            if (j + 1 < n && !segs[j + 1].line && num_args + 6 <= max_args)
+                offer(i, j + 2, Op::rlinecurve, cost + segs[j + 1].cost());
+        }
+
+        // rrcurveto, and rcurveline when a line follows the curves
+        cost = 0;
+        for (auto j = i; j < n && !segs[j].line; ++j)
+        {
+            int num_args = 6 * (j - i + 1);
+            if (num_args > max_args)
+                break;
+            cost += segs[j].cost();
+            offer(i, j + 1, Op::rrcurveto, cost);
+            if (j + 1 < n && segs[j + 1].line && num_args + 2 <= max_args)
+                offer(i, j + 2, Op::rcurveline, cost + segs[j + 1].cost());
+        }
+
+        // hlineto and vlineto: lines alternating between the axes
+        for (auto op : { Op::hlineto, Op::vlineto })
+        {
+            bool horizontal = op == Op::hlineto;
+            cost = 0;
+            for (auto j = i; j < n && segs[j].line && int(j - i) < max_args;
+                 ++j, horizontal = !horizontal)
+            {
+                auto const& d = segs[j].d;
+                if (d[horizontal ? 1 : 0] != 0)
+                    break;
+                cost += number_size(d[horizontal ? 0 : 1]);
+                offer(i, j + 1, op, cost);
+            }
+        }
+
+        // hhcurveto and vvcurveto: curves along one axis, of which the
+        // first may start off it
+        for (auto op : { Op::hhcurveto, Op::vvcurveto })
+        {
+            int along = op == Op::hhcurveto ? 0 : 1, across = 1 - along;
+            int num_args = 0;
+            cost = 0;
+            for (auto j = i; j < n && !segs[j].line; ++j)
+            {
+                auto const& d = segs[j].d;
+                if (d[4 + across] != 0 || (j != i && d[across] != 0))
+                    break;
+                num_args += d[across] != 0 ? 5 : 4;
+                if (num_args > max_args)
+                    break;
+                if (d[across] != 0)
+                    cost += number_size(d[across]);
+                cost += number_size(d[along]) + number_size(d[2])
+                        + number_size(d[3]) + number_size(d[4 + along]);
+                offer(i, j + 1, op, cost);
+            }
+        }
+
+        // hvcurveto and vhcurveto: curves turning between the axes, of
+        // which the last may end off them
+        for (auto op : { Op::hvcurveto, Op::vhcurveto })
+        {
+            bool horizontal = op == Op::hvcurveto;
+            int  num_args = 0;
+            cost = 0;
+            for (auto j = i; j < n && !segs[j].line;
+                 ++j, horizontal = !horizontal)
+            {
+                auto const& d = segs[j].d;
+                int along = horizontal ? 0 : 1, across = 1 - along;
+                num_args += 4;
+                if (d[across] != 0 || num_args > max_args)
+                    break;
+                cost += number_size(d[along]) + number_size(d[2])
+                        + number_size(d[3]) + number_size(d[4 + across]);
+                if (d[4 + along] == 0)
+                    offer(i, j + 1, op, cost);
+                else
+                {
+                    if (num_args < max_args)
+                        offer(i, j + 1, op, cost + number_size(d[4 + along]));
+                    break;
+                }
+            }
+        }
+    }
+
+    std::vector<Run> runs;
+    for (auto end = n; end > 0; end = runs.back().begin)
+        runs.push_back(last[end]);
+    std::reverse(runs.begin(), runs.end());
+    return runs;
+}
+
+/// Write segments `begin` to `end` with the operator of `run`
+void write_run(
+    OutputBuffer&             out,
+    Run                       run,
+    std::vector<Delta> const& segs,
+    std::size_t               end)
+{
+    auto write_all = [&](Delta const& seg) {
+        for (int i = 0; i < (seg.line ? 2 : 6); ++i)
+            write_number(out, seg.d[i]);
+    };
+
+    switch (run.op)
+    {
+    case Op::rlineto:
+    case Op::rrcurveto:
+    case Op::rcurveline:
+    case Op::rlinecurve:
+        for (auto i = run.begin; i < end; ++i)
+            write_all(segs[i]);
+        break;
+    case Op::hlineto:
+    case Op::vlineto:
+    {
+        bool horizontal = run.op == Op::hlineto;
+        for (auto i = run.begin; i < end; ++i, horizontal = !horizontal)
+            write_number(out, segs[i].d[horizontal ? 0 : 1]);
+        break;
+    }
+    case Op::hhcurveto:
+    case Op::vvcurveto:
+    {
+        int along = run.op == Op::hhcurveto ? 0 : 1, across = 1 - along;
+        if (segs[run.begin].d[across] != 0)
+            write_number(out, segs[run.begin].d[across]);
+        for (auto i = run.begin; i < end; ++i)
+        {
+            auto const& d = segs[i].d;
+            write_number(out, d[along]);
+            write_number(out, d[2]);
+            write_number(out, d[3]);
+            write_number(out, d[4 + along]);
+        }
+        break;
+    }
+    default:
+    {
+        bool horizontal = run.op == Op::hvcurveto;
+        for (auto i = run.begin; i < end; ++i, horizontal = !horizontal)
+        {
+            auto const& d = segs[i].d;
+            int along = horizontal ? 0 : 1, across = 1 - along;
+            write_number(out, d[along]);
+            write_number(out, d[2]);
+            write_number(out, d[3]);
+            write_number(out, d[4 + across]);
+            if (i + 1 == end && d[4 + along] != 0)
+                write_number(out, d[4 + along]);
+        }
+        break;
+    }
+    }
+    write_op(out, run.op);
+}
+
+void write_glyph(OutputBuffer& out, Glyph const& glyph, int const* width)
 {
-    Point pos = { 0, 0 };
+    Point              pos = { 0, 0 };
+    std::vector<Delta> segs;
     for (auto const& path : glyph.paths)
     {
-        write_number(out, path.start.x - pos.x);
-        write_number(out, path.start.y - pos.y);
+        // the width goes before the first operator
+        if (width)
+            write_number(out, *width);
+        width = nullptr;
+
+        auto dx = path.start.x - pos.x, dy = path.start.y - pos.y;
+        if (dy == 0)
+        {
+            write_number(out, dx);
+            write_op(out, Op::hmoveto);
+        }
+        else if (dx == 0)
+        {
+            write_number(out, dy);
+            write_op(out, Op::vmoveto);
+        }
+        else
+        {
+            write_number(out, dx);
+            write_number(out, dy);
+            write_op(out, Op::rmoveto);
+        }
         pos = path.start;
-        write_op(out, Op::rmoveto);
 
+        segs.clear();
         for (auto const& seg : path.segments)
         {
             if (seg.ct1 == seg.ct2 && seg.ct2 == seg.p)
-            {
-                write_number(out, seg.p.x - pos.x);
-                write_number(out, seg.p.y - pos.y);
-                pos = seg.p;
-                write_op(out, Op::rlineto);
-            }
+                segs.push_back({ true, { seg.p.x - pos.x, seg.p.y - pos.y } });
             else
             {
-                write_number(out, seg.ct1.x - pos.x);
-                write_number(out, seg.ct1.y - pos.y);
-                pos = seg.ct1;
-                write_number(out, seg.ct2.x - pos.x);
-                write_number(out, seg.ct2.y - pos.y);
-                pos = seg.ct2;
-                write_number(out, seg.p.x - pos.x);
-                write_number(out, seg.p.y - pos.y);
-                pos = seg.p;
-                write_op(out, Op::rrcurveto);
+                segs.push_back({ false,
+                                 { seg.ct1.x - pos.x,
+                                   seg.ct1.y - pos.y,
+                                   seg.ct2.x - seg.ct1.x,
+                                   seg.ct2.y - seg.ct1.y,
+                                   seg.p.x - seg.ct2.x,
+                                   seg.p.y - seg.ct2.y } });
             }
+            pos = seg.p;
+        }
+
+        auto runs = plan_runs(segs);
+        for (auto i = 0u; i < runs.size(); ++i)
+        {
+            auto end = i + 1 < runs.size() ? runs[i + 1].begin : segs.size();
+            write_run(out, runs[i], segs, end);
         }
     }
 
+    if (width)
+        write_number(out, *width);
     write_op(out, Op::endchar);
 }
 }
+
+void write_charstring(
+    OutputBuffer& out,
+    Glyph const&  glyph,
+    int           default_width,
+    int           nominal_width)
+{
+    int width = glyph.width - nominal_width;
+    write_glyph(out, glyph, glyph.width != default_width ? &width : nullptr);
+}
+
+void write_charstring(OutputBuffer& out, Glyph const& glyph)
+{
+    write_glyph(out, glyph, nullptr);
+}
+}
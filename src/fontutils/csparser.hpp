@@ -10,14 +10,42 @@
 namespace geul
 {
 
+/// Decode a Type 2 charstring. The charstring and the subroutines it
+/// calls are read where they are, without being copied.
+/// Malformed charstrings throw, or are recorded in `error` when given.
+Glyph parse_charstring(
+    ByteSpan                     cs,
+    std::vector<ByteSpan> const& gsubrs,
+    std::vector<ByteSpan> const& lsubrs,
+    int                          default_width,
+    int                          nominal_width,
+    ParseError*                  error = nullptr);
+
+/// Decode a Type 2 charstring held in strings
 Glyph parse_charstring(
     std::string const&              cs,
     std::vector<std::string> const& gsubrs,
     std::vector<std::string> const& lsubrs,
     int                             default_width,
-    int                             nominal_width);
+    int                             nominal_width,
+    ParseError*                     error = nullptr);
 
+/// Encode a glyph as a Type 2 charstring without hints, choosing for each
+/// run of segments the operators that take the fewest bytes. The width is
+/// left out when it is `default_width`, and given relative to
+/// `nominal_width` otherwise.
+void write_charstring(
+    OutputBuffer& out,
+    Glyph const&  glyph,
+    int           default_width,
+    int           nominal_width);
+
+/// Encode the paths of a glyph, leaving its width to the default
 void write_charstring(OutputBuffer& out, Glyph const& glyph);
+
+/// Number added to subroutine numbers in charstrings to get the index
+/// into an INDEX of `subr_count` subroutines
+int subr_bias(std::size_t subr_count);
 }
 
 #endif
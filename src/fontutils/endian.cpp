@@ -0,0 +1,146 @@
+#include "endian.hpp"
+
+#if defined(__AVX2__) || defined(__SSSE3__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#ifdef _MSC_VER
+#include <cstdlib>
+#endif
+
+namespace geul
+{
+
+namespace
+{
+inline uint16_t bswap(uint16_t val)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_bswap16(val);
+#elif defined(_MSC_VER)
+    return _byteswap_ushort(val);
+#else
+    return uint16_t(val << 8 | val >> 8);
+#endif
+}
+
+inline uint32_t bswap(uint32_t val)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_bswap32(val);
+#elif defined(_MSC_VER)
+    return _byteswap_ulong(val);
+#else
+    return (val << 24) | ((val << 8) & 0xff0000) | ((val >> 8) & 0xff00)
+           | (val >> 24);
+#endif
+}
+
+inline uint64_t bswap(uint64_t val)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_bswap64(val);
+#elif defined(_MSC_VER)
+    return _byteswap_uint64(val);
+#else
+    return uint64_t(bswap(uint32_t(val))) << 32 | bswap(uint32_t(val >> 32));
+#endif
+}
+
+// Swap the remaining items one by one
+template <typename T>
+void bswap_tail(char const* src, char* dest, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        T val;
+        std::memcpy(&val, src + i * sizeof(T), sizeof(T));
+        val = bswap(val);
+        std::memcpy(dest + i * sizeof(T), &val, sizeof(T));
+    }
+}
+}
+
+void byteswap16(char const* src, char* dest, std::size_t count)
+{
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    auto const mask = _mm256_setr_epi8(
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    for (; i + 16 <= count; i += 16)
+    {
+        auto v = _mm256_loadu_si256(
+            reinterpret_cast<__m256i const*>(src + i * 2));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(dest + i * 2),
+            _mm256_shuffle_epi8(v, mask));
+    }
+#elif defined(__SSE2__)
+    for (; i + 8 <= count; i += 8)
+    {
+        auto v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i * 2));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 2), v);
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 8 <= count; i += 8)
+    {
+        auto v = vld1q_u8(reinterpret_cast<uint8_t const*>(src + i * 2));
+        vst1q_u8(reinterpret_cast<uint8_t*>(dest + i * 2), vrev16q_u8(v));
+    }
+#endif
+    bswap_tail<uint16_t>(src + i * 2, dest + i * 2, count - i);
+}
+
+void byteswap32(char const* src, char* dest, std::size_t count)
+{
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    auto const mask = _mm256_setr_epi8(
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    for (; i + 8 <= count; i += 8)
+    {
+        auto v = _mm256_loadu_si256(
+            reinterpret_cast<__m256i const*>(src + i * 4));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(dest + i * 4),
+            _mm256_shuffle_epi8(v, mask));
+    }
+#elif defined(__SSSE3__)
+    auto const mask
+        = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    for (; i + 4 <= count; i += 4)
+    {
+        auto v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i * 4));
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(dest + i * 4), _mm_shuffle_epi8(v, mask));
+    }
+#elif defined(__SSE2__)
+    for (; i + 4 <= count; i += 4)
+    {
+        auto v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i * 4));
+        // swap the 16-bit halves, then the bytes within them
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4), v);
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 4 <= count; i += 4)
+    {
+        auto v = vld1q_u8(reinterpret_cast<uint8_t const*>(src + i * 4));
+        vst1q_u8(reinterpret_cast<uint8_t*>(dest + i * 4), vrev32q_u8(v));
+    }
+#endif
+    bswap_tail<uint32_t>(src + i * 4, dest + i * 4, count - i);
+}
+
+void byteswap64(char const* src, char* dest, std::size_t count)
+{
+    bswap_tail<uint64_t>(src, dest, count);
+}
+}
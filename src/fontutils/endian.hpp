@@ -3,6 +3,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <type_traits>
 #include <utility>
 
@@ -46,6 +47,83 @@ template <typename T> void to_big_endian(char* arr, T val)
     }
 }
 
+/// Reverse the byte order of each 2-byte item.
+/// `src` and `dest` may be the same array.
+void byteswap16(char const* src, char* dest, std::size_t count);
+
+/// Reverse the byte order of each 4-byte item.
+/// `src` and `dest` may be the same array.
+void byteswap32(char const* src, char* dest, std::size_t count);
+
+/// Reverse the byte order of each 8-byte item.
+/// `src` and `dest` may be the same array.
+void byteswap64(char const* src, char* dest, std::size_t count);
+
+namespace detail
+{
+// Arrays shorter than this are converted one item at a time
+constexpr std::size_t bulk_threshold = 8;
+
+// Convert between big-endian bytes and machine representation,
+// which is the same operation in both directions
+template <typename T>
+void swap_bytes(char const* src, char* dest, std::size_t count)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    std::memmove(dest, src, count * sizeof(T));
+#else
+    switch (sizeof(T))
+    {
+    case 1:
+        std::memmove(dest, src, count);
+        break;
+    case 2:
+        byteswap16(src, dest, count);
+        break;
+    case 4:
+        byteswap32(src, dest, count);
+        break;
+    case 8:
+        byteswap64(src, dest, count);
+        break;
+    }
+#endif
+}
+}
+
+/// Convert an array of big-endian items into machine endian
+template <typename T>
+void to_machine_endian(char const* arr, T* dest, std::size_t count)
+{
+    static_assert(
+        std::is_integral<T>::value || std::is_enum<T>::value,
+        "Type is not integral nor enum");
+
+    if (count < detail::bulk_threshold)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            dest[i] = to_machine_endian<T>(arr + i * sizeof(T));
+    }
+    else
+        detail::swap_bytes<T>(arr, reinterpret_cast<char*>(dest), count);
+}
+
+/// Convert an array of items into big-endian bytes
+template <typename T>
+void to_big_endian(char* arr, T const* src, std::size_t count)
+{
+    static_assert(
+        std::is_integral<T>::value || std::is_enum<T>::value,
+        "Type is not integral nor enum");
+
+    if (count < detail::bulk_threshold)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            to_big_endian<T>(arr + i * sizeof(T), src[i]);
+    }
+    else
+        detail::swap_bytes<T>(reinterpret_cast<char const*>(src), arr, count);
+}
 }
 
 #endif
@@ -1,5 +1,7 @@
 #include "glyph.hpp"
 
+#include "checksum.hpp"
+
 namespace geul
 {
 
@@ -23,9 +25,42 @@ void Path::curveto(Point ct1, Point ct2, Point p)
     segments.push_back({ ct1, ct2, p });
 }
 
+static_assert(
+    sizeof(Path::Segment) == 6 * sizeof(int), "Segment must not be padded");
+
+uint64_t Glyph::hash() const
+{
+    if (!hashed_)
+    {
+        // Points and segments are plain ints, hashed as they are in memory
+        uint64_t hash = content_hash(
+            reinterpret_cast<char const*>(&width), sizeof(width),
+            paths.size());
+        for (auto const& path : paths)
+        {
+            hash = content_hash(
+                reinterpret_cast<char const*>(&path.start), sizeof(Point),
+                hash);
+            hash = content_hash(
+                reinterpret_cast<char const*>(path.segments.data()),
+                path.segments.size() * sizeof(Path::Segment), hash);
+        }
+        hash_ = hash;
+        hashed_ = true;
+    }
+    return hash_;
+}
+
+void Glyph::invalidate_hash() noexcept
+{
+    hashed_ = false;
+}
+
 bool Glyph::operator==(Glyph const& rhs) const noexcept
 {
-    return paths == rhs.paths;
+    if (hashed_ && rhs.hashed_ && hash_ != rhs.hash_)
+        return false;
+    return width == rhs.width && paths == rhs.paths;
 }
 
 bool Path::operator==(Path const& rhs) const noexcept
@@ -1,6 +1,7 @@
 #ifndef FONTUTILS_GLYPH_HPP
 #define FONTUTILS_GLYPH_HPP
 
+#include <cstdint>
 #include <vector>
 
 namespace geul
@@ -34,9 +35,22 @@ struct Path
 struct Glyph
 {
     std::vector<Path> paths;
-    int width;
+    int width = 0;
 
+    /// Hash of the width and paths, the same for glyphs that compare
+    /// equal. Cached until invalidate_hash() is called after changing them.
+    uint64_t hash() const;
+
+    /// Forget the cached hash, after the width or paths are changed
+    void invalidate_hash() noexcept;
+
+    /// Glyphs are equal when their widths and paths are. Those with
+    /// different cached hashes differ without comparing them.
     bool operator==(Glyph const& rhs) const noexcept;
+
+private:
+    mutable uint64_t hash_ = 0;
+    mutable bool     hashed_ = false;
 };
 }
 #endif
@@ -1,24 +1,94 @@
 #include "otfparser.hpp"
 
+#include "tables/cfftable.hpp"
+
 #include <fstream>
 
 namespace geul
 {
 
 // parse file into Font
-Font parse_otf(const std::string& filename)
+Font parse_otf(const std::string& filename, ParseOptions const& options)
 {
     Font font;
-    auto input_buf = InputBuffer::open(filename);
-    font.parse(input_buf);
+    auto input_buf = InputBuffer::map(filename);
+    auto view = input_buf.view();
+    font.parse(view, options);
+
+    return font;
+}
+
+FontCollection
+    parse_otc(std::string const& filename, ParseOptions const& options)
+{
+    FontCollection collection;
+    auto           input_buf = InputBuffer::map(filename);
+    auto           view = input_buf.view();
+    collection.parse(view, options);
 
+    return collection;
+}
+
+namespace
+{
+ParseResult<Font> try_parse(BufferView view, ParseOptions const& options)
+{
+    ParseError error;
+    Font       font;
+    auto       reporting = view.report_to(&error);
+    font.parse(reporting, options);
+    if (!error)
+        font.parse_tables(reporting);
+
+    // Charstrings are decoded on first use, and would throw then
+    Font const& parsed = font;
+    auto        cff = error ? nullptr : parsed.table<CFFTable>();
+    if (cff)
+    {
+        for (auto const& cff_font : cff->fonts)
+        {
+            cff_font.glyphs.validate(1, &error);
+            if (error)
+                break;
+        }
+    }
+    if (error)
+        return error;
     return font;
 }
+}
+
+ParseResult<Font> try_parse_otf(ByteSpan bytes, ParseOptions const& options)
+{
+    return try_parse(BufferView(bytes), options);
+}
+
+ParseResult<Font>
+    try_parse_otf(std::string const& filename, ParseOptions const& options)
+{
+    auto input_buf = InputBuffer::map(filename);
+    return try_parse(input_buf.view(), options);
+}
 
 // write Font to file
 void write_otf(const Font& font, const std::string& filename)
 {
-    auto buf = OutputBuffer::open(filename);
+    OutputBuffer buf;
     font.compile(buf);
+    buf.save(filename);
+}
+
+// write Font to a stream
+void write_otf(const Font& font, std::ostream& os)
+{
+    font.compile(os);
+}
+
+// write fonts to a collection file
+void write_otc(FontCollection const& collection, std::string const& filename)
+{
+    OutputBuffer buf;
+    collection.compile(buf);
+    buf.save(filename);
 }
 }
@@ -1,13 +1,41 @@
 #ifndef FONTUTILS_OTFPARSER_HPP
 #define FONTUTILS_OTFPARSER_HPP
 
+#include "parseerror.hpp"
+#include "parseoptions.hpp"
 #include "tables/font.hpp"
+#include "tables/fontcollection.hpp"
 
 namespace geul
 {
-Font parse_otf(std::string const& filename);
+/// Parse the table directory of a font file.
+/// Tables are parsed on first access and may throw then.
+Font parse_otf(
+    std::string const& filename, ParseOptions const& options = ParseOptions());
+
+/// Parse a font and all its tables, decoding every charstring, without
+/// throwing on malformed input.
+/// The error tells what went wrong, in which table and where.
+ParseResult<Font> try_parse_otf(
+    ByteSpan bytes, ParseOptions const& options = ParseOptions());
+
+/// Parse a font file without throwing on malformed input.
+/// Failing to open the file still throws.
+ParseResult<Font> try_parse_otf(
+    std::string const&  filename,
+    ParseOptions const& options = ParseOptions());
+
+/// Parse the fonts of an OpenType Collection file (.otc, .ttc)
+FontCollection parse_otc(
+    std::string const& filename, ParseOptions const& options = ParseOptions());
 
 void write_otf(const Font& font, const std::string& filename);
+
+/// Write a font to a stream, e.g. a pipe, without seeking
+void write_otf(const Font& font, std::ostream& os);
+
+/// Write fonts to a collection file, storing each distinct table once
+void write_otc(FontCollection const& collection, std::string const& filename);
 }
 
 #endif
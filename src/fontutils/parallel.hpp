@@ -0,0 +1,48 @@
+#ifndef FONTUTILS_PARALLEL_HPP
+#define FONTUTILS_PARALLEL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace geul
+{
+/// Call `task(i)` for every i in [0, count) on up to `num_threads`
+/// threads, including the calling one. When tasks throw, every task
+/// still runs and the exception of the lowest index is rethrown.
+template <typename Task>
+void parallel_for(std::size_t count, unsigned num_threads, Task&& task)
+{
+    std::vector<std::exception_ptr> exceptions(count);
+    std::atomic<std::size_t>        next(0);
+
+    auto work = [&] {
+        for (auto i = next++; i < count; i = next++)
+        {
+            try
+            {
+                task(i);
+            }
+            catch (...)
+            {
+                exceptions[i] = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (auto n = 1u; n < num_threads && n < count; ++n)
+        workers.emplace_back(work);
+    work();
+    for (auto& worker : workers)
+        worker.join();
+
+    for (auto const& exception : exceptions)
+        if (exception)
+            std::rethrow_exception(exception);
+}
+}
+
+#endif
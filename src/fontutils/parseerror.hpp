@@ -0,0 +1,87 @@
+#ifndef FONTUTILS_PARSEERROR_HPP
+#define FONTUTILS_PARSEERROR_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace geul
+{
+
+/// Where and why malformed input could not be parsed
+struct ParseError
+{
+    enum class Code
+    {
+        none,
+        out_of_bounds,  // read past the end of the input or a table
+        unsupported,    // unrecognized version or format
+        bad_value,      // value outside of its valid range
+        bad_checksum,   // table or font checksum mismatch
+        missing_table,  // required table not present
+        bad_charstring, // malformed Type 2 charstring
+    };
+
+    Code        code = Code::none;
+    std::string tag;        ///< Table being parsed, empty for the header
+    std::size_t offset = 0; ///< Offset from the beginning of the input
+    std::string message;
+
+    explicit operator bool() const noexcept
+    {
+        return code != Code::none;
+    }
+};
+
+/// Either a parsed value or the error that stopped parsing
+template <typename T> class ParseResult
+{
+    T          value_ = {};
+    ParseError error_;
+
+public:
+    ParseResult(T&& value)
+        : value_(std::move(value))
+    {}
+
+    ParseResult(ParseError&& error)
+        : error_(std::move(error))
+    {}
+
+    bool has_value() const noexcept
+    {
+        return !error_;
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return has_value();
+    }
+
+    /// The parsed value, throws the error when there is none
+    T& value()
+    {
+        if (error_)
+            throw std::runtime_error(error_.message);
+        return value_;
+    }
+
+    T& operator*() noexcept
+    {
+        return value_;
+    }
+
+    T* operator->() noexcept
+    {
+        return &value_;
+    }
+
+    ParseError const& error() const noexcept
+    {
+        return error_;
+    }
+};
+}
+
+#endif // FONTUTILS_PARSEERROR_HPP
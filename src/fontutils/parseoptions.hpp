@@ -0,0 +1,34 @@
+#ifndef FONTUTILS_PARSEOPTIONS_HPP
+#define FONTUTILS_PARSEOPTIONS_HPP
+
+#include <string>
+#include <vector>
+
+namespace geul
+{
+
+/// How much of a font to read and check
+struct ParseOptions
+{
+    enum class Checksums
+    {
+        verify,   // fail on any mismatch
+        skip,     // never computed
+        deferred, // computed by Font::verify_checksums() on request
+    };
+
+    Checksums checksums = Checksums::verify;
+
+    /// Tags of the tables to read, or empty to read all of them.
+    /// Tables they depend on are read too. The others are never parsed
+    /// nor checked, and are written back as they were. The font checksum
+    /// can no longer be verified.
+    std::vector<std::string> tables;
+
+    /// Fail when a table required for CFF outlines is missing.
+    /// Tables that other tables depend on are required regardless.
+    bool require_tables = true;
+};
+}
+
+#endif // FONTUTILS_PARSEOPTIONS_HPP
@@ -0,0 +1,770 @@
+#include "subroutinizer.hpp"
+
+#include "csparser.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+namespace geul
+{
+
+namespace
+{
+// Type 2 operators
+constexpr uint8_t callsubr = 10, return_ = 11, escape = 12, endchar = 14,
+                  hintmask = 19, cntrmask = 20, callgsubr = 29;
+
+// Type 2 charstrings nest subroutines at most 10 deep
+constexpr int max_subr_depth = 10;
+
+// Most sequences considered as subroutines, best estimated savings first
+constexpr std::size_t max_candidates = 1 << 15;
+
+// Most rounds of dropping subroutines that do not pay off
+constexpr int max_rounds = 4;
+
+// Bytes of a call before the numbers of subroutines are known
+constexpr int initial_call_cost = 3;
+
+// Bytes of a subroutine besides its body: return and its INDEX offset
+constexpr int subr_overhead = 5;
+
+/// Token packed as its bytes, big-endian, followed by its size
+using Token = uint64_t;
+
+std::size_t token_size(Token token)
+{
+    return token & 0xff;
+}
+
+// Symbols of the tokens of up to 3 bytes
+constexpr int num_short_symbols = 256 + 9 * 256 + 65536;
+
+/// Number of a token of up to 3 bytes, made from its bytes
+int short_symbol(Token token)
+{
+    int bytes = token >> 8;
+    switch (token_size(token))
+    {
+    case 1:
+        return bytes;
+    case 2:
+        // 2-byte operators, then numbers from 247 to 254
+        return 256 + (bytes >> 8 == escape ? 8 : (bytes >> 8) - 247) * 256
+               + (bytes & 0xff);
+    case 3:
+        return 256 + 9 * 256 + (bytes & 0xffff);
+    default:
+        return 0;
+    }
+}
+
+void write_token(std::string& out, Token token)
+{
+    for (auto i = token_size(token); i > 0; --i)
+        out += char(token >> (8 * i));
+}
+
+/// Append the shortest encoding of a subroutine number
+void write_number(std::string& out, int val)
+{
+    if (-107 <= val && val <= 107)
+        out += char(val + 139);
+    else if (108 <= val && val <= 1131)
+    {
+        out += char(((val - 108) >> 8) + 247);
+        out += char((val - 108) & 0xff);
+    }
+    else if (-1131 <= val && val <= -108)
+    {
+        out += char(((-val - 108) >> 8) + 251);
+        out += char((-val - 108) & 0xff);
+    }
+    else
+    {
+        out += char(28);
+        out += char(val >> 8);
+        out += char(val & 0xff);
+    }
+}
+
+int number_size(int val)
+{
+    if (-107 <= val && val <= 107)
+        return 1;
+    if (-1131 <= val && val <= 1131)
+        return 2;
+    return 3;
+}
+
+/// Tokens of a charstring before its final endchar.
+/// Returns false when they cannot be moved around: for hint masks,
+/// whose bytes are not tokens, or for code after endchar.
+bool tokenize(std::string const& cs, std::vector<Token>& tokens)
+{
+    for (std::size_t i = 0; i < cs.size();)
+    {
+        auto b0 = uint8_t(cs[i]);
+        if (b0 == hintmask || b0 == cntrmask)
+            return false;
+        if (b0 == callsubr || b0 == callgsubr || b0 == return_)
+            throw std::runtime_error("Charstring already calls subroutines");
+        if (b0 == endchar)
+            return i + 1 == cs.size();
+
+        std::size_t size = 1;
+        if (b0 == 28)
+            size = 3;
+        else if (b0 == escape || (247 <= b0 && b0 <= 254))
+            size = 2;
+        else if (b0 == 255)
+            size = 5;
+        if (size > cs.size() - i)
+            throw std::runtime_error("Truncated charstring");
+
+        Token token = 0;
+        for (std::size_t j = 0; j < size; ++j)
+            token = token << 8 | uint8_t(cs[i + j]);
+        tokens.push_back(token << 8 | size);
+        i += size;
+    }
+    throw std::runtime_error("Charstring does not end with endchar");
+}
+
+/// Suffix array of `text` over symbols in [0, alphabet), by induced
+/// sorting (SA-IS) in linear time
+std::vector<int> suffix_array(std::vector<int> const& text, int alphabet)
+{
+    int const n = text.size();
+    if (n <= 2)
+    {
+        if (n == 2 && text[1] <= text[0])
+            return { 1, 0 };
+        std::vector<int> sa(n);
+        for (int i = 0; i < n; ++i)
+            sa[i] = i;
+        return sa;
+    }
+
+    // Whether each suffix is smaller than the next one (S-type)
+    std::vector<char> is_s(n);
+    for (int i = n - 2; i >= 0; --i)
+        is_s[i] = text[i] == text[i + 1] ? is_s[i + 1] : text[i] < text[i + 1];
+
+    // Beginning of the bucket of each symbol, and of its S-type part
+    std::vector<int> bucket_l(alphabet + 1), bucket_s(alphabet + 1);
+    for (int i = 0; i < n; ++i)
+    {
+        if (is_s[i])
+            ++bucket_l[text[i] + 1];
+        else
+            ++bucket_s[text[i]];
+    }
+    for (int c = 0; c <= alphabet; ++c)
+    {
+        bucket_s[c] += bucket_l[c];
+        if (c < alphabet)
+            bucket_l[c + 1] += bucket_s[c];
+    }
+
+    std::vector<int> sa(n);
+    std::vector<int> next(alphabet + 1);
+
+    // Sort all suffixes from sorted leftmost S-type suffixes
+    auto induce = [&](std::vector<int> const& lms) {
+        std::fill(sa.begin(), sa.end(), -1);
+        next = bucket_s;
+        for (auto i : lms)
+            sa[next[text[i]]++] = i;
+
+        next = bucket_l;
+        sa[next[text[n - 1]]++] = n - 1;
+        for (int k = 0; k < n; ++k)
+        {
+            int i = sa[k] - 1;
+            if (i >= 0 && !is_s[i])
+                sa[next[text[i]]++] = i;
+        }
+
+        next = bucket_l;
+        for (int k = n - 1; k >= 0; --k)
+        {
+            int i = sa[k] - 1;
+            if (i >= 0 && is_s[i])
+                sa[--next[text[i] + 1]] = i;
+        }
+    };
+
+    std::vector<int> lms_index(n, -1);
+    std::vector<int> lms;
+    for (int i = 1; i < n; ++i)
+    {
+        if (!is_s[i - 1] && is_s[i])
+        {
+            lms_index[i] = lms.size();
+            lms.push_back(i);
+        }
+    }
+    induce(lms);
+    if (lms.empty())
+        return sa;
+
+    // Name the substrings between LMS positions in sorted order,
+    // and sort them as a shorter text if some are alike
+    int const        m = lms.size();
+    std::vector<int> sorted;
+    sorted.reserve(m);
+    for (auto i : sa)
+        if (lms_index[i] != -1)
+            sorted.push_back(i);
+
+    std::vector<int> reduced(m);
+    int              names = 0;
+    for (int k = 1; k < m; ++k)
+    {
+        int l = sorted[k - 1], r = sorted[k];
+        int end_l = lms_index[l] + 1 < m ? lms[lms_index[l] + 1] : n;
+        int end_r = lms_index[r] + 1 < m ? lms[lms_index[r] + 1] : n;
+        bool same = end_l - l == end_r - r;
+        for (; same && l < end_l; ++l, ++r)
+            same = text[l] == text[r];
+        if (same && (l == n || r == n || text[l] != text[r]))
+            same = false;
+        if (!same)
+            ++names;
+        reduced[lms_index[sorted[k]]] = names;
+    }
+
+    auto reduced_sa = suffix_array(reduced, names + 1);
+    for (int k = 0; k < m; ++k)
+        sorted[k] = lms[reduced_sa[k]];
+    induce(sorted);
+    return sa;
+}
+
+/// Longest common prefix of each suffix in `sa` and the one before it
+std::vector<int>
+    lcp_array(std::vector<int> const& text, std::vector<int> const& sa)
+{
+    auto const       n = text.size();
+    std::vector<int> rank(n), lcp(n);
+    for (std::size_t k = 0; k < n; ++k)
+        rank[sa[k]] = k;
+
+    std::size_t h = 0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        if (rank[i] == 0)
+        {
+            h = 0;
+            continue;
+        }
+        std::size_t j = sa[rank[i] - 1];
+        while (i + h < n && j + h < n && text[i + h] == text[j + h])
+            ++h;
+        lcp[rank[i]] = h;
+        if (h > 0)
+            --h;
+    }
+    return lcp;
+}
+
+/// Token sequence that occurs more than once
+struct Candidate
+{
+    uint32_t start = 0;  // of its first occurrence in the text
+    uint32_t length = 0; // in tokens
+    int64_t  estimate = 0;
+
+    // Occurrences in the suffix array
+    uint32_t lb = 0, rb = 0;
+};
+
+/// Call to a subroutine at a position of the text
+struct Call
+{
+    uint32_t pos;
+    uint32_t subr;
+};
+
+class Subroutinizer
+{
+public:
+    Subroutinizer(
+        std::vector<std::string> const& charstrings, unsigned num_threads);
+
+    Subroutines run(
+        std::vector<std::string> const& charstrings,
+        std::vector<uint8_t> const&     fd_select,
+        std::size_t                     num_fds);
+
+private:
+    unsigned num_threads;
+
+    // Tokens of all glyphs, each followed by a sentinel
+    std::vector<Token>    tokens;
+    std::vector<uint32_t> prefix_cost;
+
+    // Range of the tokens of each glyph, empty when kept as it is
+    struct Range
+    {
+        uint32_t begin = 0, end = 0;
+    };
+    std::vector<Range> glyphs;
+    std::vector<bool>  verbatim;
+
+    // Sorted by length, so that callees come before their callers
+    std::vector<Candidate> candidates;
+
+    // Candidates occurring at each position of the text
+    std::vector<uint32_t> first_match, matches;
+
+    // Per candidate, from the last round
+    std::vector<char>              alive;
+    std::vector<int>               call_cost;
+    std::vector<uint32_t>          body_cost;
+    std::vector<double>            price;
+    std::vector<int>               depth;
+    std::vector<uint32_t>          uses;
+    std::vector<std::vector<Call>> body_calls;
+
+    // Per glyph
+    std::vector<std::vector<Call>> glyph_calls;
+
+    void find_candidates(std::vector<int> const& text);
+    void count_uses(std::vector<char> const& callers);
+    bool prune();
+    void encode_all();
+
+    /// Cheapest encoding of tokens [begin, end) with calls to live
+    /// subroutines shorter than `limit` tokens and at most `max_depth`
+    /// deep. Returns its size in bytes.
+    uint32_t encode(
+        uint32_t           begin,
+        uint32_t           end,
+        uint32_t           limit,
+        int                max_depth,
+        std::vector<Call>& calls) const;
+};
+
+Subroutinizer::Subroutinizer(
+    std::vector<std::string> const& charstrings, unsigned num_threads)
+    : num_threads(num_threads)
+    , glyphs(charstrings.size())
+    , verbatim(charstrings.size())
+{
+    auto const                      num_glyphs = charstrings.size();
+    std::vector<std::vector<Token>> glyph_tokens(num_glyphs);
+    std::vector<char>               movable(num_glyphs);
+    parallel_for(num_glyphs, num_threads, [&](std::size_t i) {
+        movable[i] = tokenize(charstrings[i], glyph_tokens[i]);
+    });
+
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < num_glyphs; ++i)
+    {
+        verbatim[i] = !movable[i];
+        if (verbatim[i])
+            continue;
+        glyphs[i].begin = size;
+        glyphs[i].end = size + glyph_tokens[i].size();
+        size = glyphs[i].end + 1;
+    }
+
+    // Each glyph is followed by a sentinel of its own, so that no repeat
+    // runs across glyphs, and tokens are numbered after the sentinels
+    tokens.resize(size);
+    std::vector<int> text(size);
+    parallel_for(num_glyphs, num_threads, [&](std::size_t i) {
+        if (verbatim[i])
+            return;
+        auto pos = glyphs[i].begin;
+        for (auto token : glyph_tokens[i])
+        {
+            tokens[pos] = token;
+            text[pos++] = num_glyphs + short_symbol(token);
+        }
+        text[pos] = i;
+        std::vector<Token>().swap(glyph_tokens[i]);
+    });
+
+    std::unordered_map<Token, int> long_symbols;
+    for (std::size_t pos = 0; pos < size; ++pos)
+    {
+        if (token_size(tokens[pos]) <= 3)
+            continue;
+        auto symbol = num_glyphs + num_short_symbols + long_symbols.size();
+        text[pos] = long_symbols.emplace(tokens[pos], symbol).first->second;
+    }
+
+    prefix_cost.resize(tokens.size() + 1);
+    for (std::size_t i = 0; i < tokens.size(); ++i)
+        prefix_cost[i + 1] = prefix_cost[i] + token_size(tokens[i]);
+
+    if (!text.empty())
+        find_candidates(text);
+}
+
+void Subroutinizer::find_candidates(std::vector<int> const& text)
+{
+    auto const n = text.size();
+    auto const alphabet = *std::max_element(text.begin(), text.end()) + 1;
+
+    auto sa = suffix_array(text, alphabet);
+    auto lcp = lcp_array(text, sa);
+
+    // Every repeat that cannot be extended is an interval of the suffix
+    // array where the common prefix is longer than at both ends
+    struct Interval
+    {
+        uint32_t lcp, lb;
+    };
+    std::vector<Interval> open = { { 0, 0 } };
+    for (std::size_t i = 1; i <= n; ++i)
+    {
+        uint32_t l = i < n ? lcp[i] : 0;
+        uint32_t lb = i - 1;
+        while (l < open.back().lcp)
+        {
+            auto top = open.back();
+            open.pop_back();
+            lb = top.lb;
+
+            Candidate c;
+            c.start = sa[lb];
+            c.length = top.lcp;
+            c.lb = lb;
+            c.rb = i - 1;
+
+            int64_t count = c.rb - c.lb + 1;
+            int64_t cost =
+                prefix_cost[c.start + c.length] - prefix_cost[c.start];
+            c.estimate = count * (cost - initial_call_cost)
+                         - (cost + subr_overhead);
+            if (c.estimate > 0)
+                candidates.push_back(c);
+        }
+        if (l > open.back().lcp)
+            open.push_back({ l, lb });
+    }
+    std::vector<int>().swap(lcp);
+
+    if (candidates.size() > max_candidates)
+    {
+        auto better = [](Candidate const& a, Candidate const& b) {
+            return std::make_tuple(-a.estimate, a.start, a.length)
+                   < std::make_tuple(-b.estimate, b.start, b.length);
+        };
+        std::nth_element(
+            candidates.begin(),
+            candidates.begin() + max_candidates,
+            candidates.end(),
+            better);
+        candidates.resize(max_candidates);
+    }
+    std::sort(
+        candidates.begin(),
+        candidates.end(),
+        [](Candidate const& a, Candidate const& b) {
+            return std::make_pair(a.length, a.start)
+                   < std::make_pair(b.length, b.start);
+        });
+
+    first_match.assign(n + 1, 0);
+    for (auto const& c : candidates)
+        for (auto k = c.lb; k <= c.rb; ++k)
+            ++first_match[sa[k] + 1];
+    for (std::size_t i = 0; i < n; ++i)
+        first_match[i + 1] += first_match[i];
+
+    matches.resize(first_match[n]);
+    auto next = first_match;
+    for (uint32_t c = 0; c < candidates.size(); ++c)
+        for (auto k = candidates[c].lb; k <= candidates[c].rb; ++k)
+            matches[next[sa[k]]++] = c;
+}
+
+uint32_t Subroutinizer::encode(
+    uint32_t           begin,
+    uint32_t           end,
+    uint32_t           limit,
+    int                max_depth,
+    std::vector<Call>& calls) const
+{
+    uint32_t const none = -1;
+    auto const     size = end - begin;
+
+    // Cheapest encoding of each suffix of the range, and its first call.
+    // Calls are priced with a share of the subroutine they call, so that
+    // subroutines that do not pay for themselves are not called.
+    std::vector<double>   best(size + 1);
+    std::vector<uint32_t> choice(size + 1, none);
+    for (auto i = size; i-- > 0;)
+    {
+        auto pos = begin + i;
+        best[i] = best[i + 1] + token_size(tokens[pos]);
+        for (auto m = first_match[pos]; m < first_match[pos + 1]; ++m)
+        {
+            auto        subr = matches[m];
+            auto const& c = candidates[subr];
+            if (!alive[subr] || c.length >= limit || c.length > size - i
+                || depth[subr] > max_depth)
+                continue;
+
+            auto cost = price[subr] + best[i + c.length];
+            if (cost < best[i])
+            {
+                best[i] = cost;
+                choice[i] = subr;
+            }
+        }
+    }
+
+    calls.clear();
+    uint32_t bytes = prefix_cost[end] - prefix_cost[begin];
+    for (uint32_t i = 0; i < size;)
+    {
+        if (choice[i] == none)
+        {
+            ++i;
+            continue;
+        }
+        auto pos = begin + i;
+        auto subr = choice[i];
+        calls.push_back({ pos, subr });
+        i += candidates[subr].length;
+        bytes -= prefix_cost[begin + i] - prefix_cost[pos];
+        bytes += call_cost[subr];
+    }
+    return bytes;
+}
+
+void Subroutinizer::encode_all()
+{
+    // Callees are shorter, so they are encoded before their callers
+    for (uint32_t c = 0; c < candidates.size(); ++c)
+    {
+        if (!alive[c])
+            continue;
+        auto const& cand = candidates[c];
+        body_cost[c] = encode(
+            cand.start,
+            cand.start + cand.length,
+            cand.length,
+            max_subr_depth - 1,
+            body_calls[c]);
+
+        depth[c] = 1;
+        for (auto call : body_calls[c])
+            depth[c] = std::max(depth[c], depth[call.subr] + 1);
+    }
+
+    parallel_for(glyphs.size(), num_threads, [&](std::size_t i) {
+        encode(
+            glyphs[i].begin,
+            glyphs[i].end,
+            -1,
+            max_subr_depth,
+            glyph_calls[i]);
+    });
+}
+
+void Subroutinizer::count_uses(std::vector<char> const& callers)
+{
+    uses.assign(candidates.size(), 0);
+    for (auto const& calls : glyph_calls)
+        for (auto call : calls)
+            ++uses[call.subr];
+    for (uint32_t c = 0; c < candidates.size(); ++c)
+        if (callers[c])
+            for (auto call : body_calls[c])
+                ++uses[call.subr];
+}
+
+bool Subroutinizer::prune()
+{
+    count_uses(alive);
+
+    bool pruned = false;
+    for (uint32_t c = 0; c < candidates.size(); ++c)
+    {
+        if (!alive[c])
+            continue;
+        int64_t cost = body_cost[c];
+        int64_t savings =
+            uses[c] * (cost - call_cost[c]) - (cost + subr_overhead);
+        if (uses[c] < 2 || savings <= 0)
+        {
+            alive[c] = false;
+            pruned = true;
+        }
+    }
+
+    // The most used subroutines get the shortest numbers
+    std::vector<uint32_t> order;
+    for (uint32_t c = 0; c < candidates.size(); ++c)
+        if (alive[c])
+            order.push_back(c);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return uses[a] > uses[b];
+    });
+    int bias = subr_bias(order.size());
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        auto c = order[i];
+        call_cost[c] = 1 + number_size(int(i) - bias);
+        price[c] = call_cost[c]
+                   + double(body_cost[c] + subr_overhead) / uses[c];
+    }
+
+    return pruned;
+}
+
+Subroutines Subroutinizer::run(
+    std::vector<std::string> const& charstrings,
+    std::vector<uint8_t> const&     fd_select,
+    std::size_t                     num_fds)
+{
+    auto const num_subrs = candidates.size();
+    alive.assign(num_subrs, true);
+    call_cost.assign(num_subrs, initial_call_cost);
+    body_cost.assign(num_subrs, 0);
+    price.resize(num_subrs);
+    for (std::size_t c = 0; c < num_subrs; ++c)
+    {
+        auto const& cand = candidates[c];
+        auto        cost = prefix_cost[cand.start + cand.length]
+                    - prefix_cost[cand.start];
+        price[c] = initial_call_cost
+                   + double(cost + subr_overhead) / (cand.rb - cand.lb + 1);
+    }
+    depth.assign(num_subrs, 0);
+    body_calls.assign(num_subrs, {});
+    glyph_calls.assign(glyphs.size(), {});
+
+    for (int round = 1;; ++round)
+    {
+        encode_all();
+        if (round == max_rounds || !prune())
+            break;
+    }
+
+    // Keep the subroutines that are called, longest callers first
+    std::vector<char> used(num_subrs);
+    for (auto const& calls : glyph_calls)
+        for (auto call : calls)
+            used[call.subr] = true;
+    for (auto c = num_subrs; c-- > 0;)
+        if (used[c])
+            for (auto call : body_calls[c])
+                used[call.subr] = true;
+    count_uses(used);
+
+    // Subroutines called from a single font dict are local to it.
+    // Callees are reached from at least the font dicts of their callers,
+    // so global subroutines only call global ones.
+    int const         no_fd = -1, shared = -2;
+    std::vector<int>  fd(num_subrs, no_fd);
+    auto merge = [&](uint32_t subr, int from) {
+        if (fd[subr] == no_fd)
+            fd[subr] = from;
+        else if (fd[subr] != from)
+            fd[subr] = shared;
+    };
+    for (std::size_t i = 0; i < glyphs.size(); ++i)
+    {
+        int from = fd_select.empty() ? 0 : fd_select[i];
+        if (std::size_t(from) >= num_fds)
+            from = shared;
+        for (auto call : glyph_calls[i])
+            merge(call.subr, from);
+    }
+    for (auto c = num_subrs; c-- > 0;)
+        if (used[c])
+            for (auto call : body_calls[c])
+                merge(call.subr, fd[c]);
+
+    std::vector<uint32_t> order;
+    for (uint32_t c = 0; c < num_subrs; ++c)
+        if (used[c])
+            order.push_back(c);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return uses[a] > uses[b];
+    });
+
+    std::vector<uint32_t>              global;
+    std::vector<std::vector<uint32_t>> local(num_fds);
+    for (auto c : order)
+        (fd[c] == shared ? global : local[fd[c]]).push_back(c);
+
+    std::vector<int> number(num_subrs);
+    auto assign = [&](std::vector<uint32_t> const& subrs) {
+        int bias = subr_bias(subrs.size());
+        for (std::size_t i = 0; i < subrs.size(); ++i)
+            number[subrs[i]] = int(i) - bias;
+    };
+    assign(global);
+    for (auto const& subrs : local)
+        assign(subrs);
+
+    auto emit = [&](uint32_t begin, uint32_t end,
+                    std::vector<Call> const& calls, std::string& out) {
+        auto call = calls.begin();
+        for (auto i = begin; i < end;)
+        {
+            if (call != calls.end() && call->pos == i)
+            {
+                write_number(out, number[call->subr]);
+                out += char(fd[call->subr] == shared ? callgsubr : callsubr);
+                i += candidates[call->subr].length;
+                ++call;
+                continue;
+            }
+            write_token(out, tokens[i++]);
+        }
+    };
+
+    Subroutines result;
+    result.charstrings.resize(glyphs.size());
+    parallel_for(glyphs.size(), num_threads, [&](std::size_t i) {
+        auto& cs = result.charstrings[i];
+        if (verbatim[i])
+        {
+            cs = charstrings[i];
+            return;
+        }
+        emit(glyphs[i].begin, glyphs[i].end, glyph_calls[i], cs);
+        cs += char(endchar);
+    });
+
+    auto emit_subrs = [&](std::vector<uint32_t> const& subrs) {
+        std::vector<std::string> bodies(subrs.size());
+        for (std::size_t i = 0; i < subrs.size(); ++i)
+        {
+            auto const& c = candidates[subrs[i]];
+            emit(c.start, c.start + c.length, body_calls[subrs[i]], bodies[i]);
+            bodies[i] += char(return_);
+        }
+        return bodies;
+    };
+    result.gsubrs = emit_subrs(global);
+    for (auto const& subrs : local)
+        result.lsubrs.push_back(emit_subrs(subrs));
+    return result;
+}
+}
+
+Subroutines find_subroutines(
+    std::vector<std::string> const& charstrings,
+    std::vector<uint8_t> const&     fd_select,
+    std::size_t                     num_fds,
+    unsigned                        num_threads)
+{
+    Subroutinizer subroutinizer(charstrings, num_threads);
+    return subroutinizer.run(charstrings, fd_select, num_fds);
+}
+}
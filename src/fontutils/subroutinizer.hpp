@@ -0,0 +1,41 @@
+#ifndef FONTUTILS_SUBROUTINIZER_HPP
+#define FONTUTILS_SUBROUTINIZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace geul
+{
+
+/// Charstrings with the code they have in common moved to subroutines
+struct Subroutines
+{
+    /// Charstring of each glyph
+    std::vector<std::string> charstrings;
+
+    /// Subroutines called from glyphs of several font dicts
+    std::vector<std::string> gsubrs;
+
+    /// Subroutines of each font dict
+    std::vector<std::vector<std::string>> lsubrs;
+};
+
+/// Move token sequences that repeat across `charstrings` to subroutines,
+/// nested at most as deep as Type 2 charstrings allow.
+/// Charstrings are made of numbers and operators and end with endchar,
+/// like those of write_charstring(). Those with hint masks are kept as
+/// they are, and those that call subroutines already are rejected.
+/// `fd_select` is the font dict of each glyph out of `num_fds`, or empty
+/// when there is only one. With no font dicts, all subroutines are global.
+/// Work is spread over up to `num_threads` threads, with the same result
+/// for any number of them.
+Subroutines find_subroutines(
+    std::vector<std::string> const& charstrings,
+    std::vector<uint8_t> const&     fd_select,
+    std::size_t                     num_fds,
+    unsigned                        num_threads = 1);
+}
+
+#endif
@@ -12,100 +12,110 @@ BaseTable::BaseTable()
 
 namespace
 {
-BaseTable::Axis parse_axis(InputBuffer& dis)
+BaseTable::Axis parse_axis(BufferView& dis)
 {
     BaseTable::Axis axis;
 
     auto table_begin = dis.tell();
 
-    std::streamoff base_tag_list_offset = dis.read<uint16_t>();
-    std::streamoff base_script_list_offset = dis.read<uint16_t>();
+    std::size_t base_tag_list_offset = dis.read<uint16_t>();
+    std::size_t base_script_list_offset = dis.read<uint16_t>();
 
     // BaseTagList table
     {
-        auto lock = dis.seek_lock(table_begin + base_tag_list_offset);
+        auto tag_list_dis = dis.at(table_begin + base_tag_list_offset);
 
-        auto base_tag_count = dis.read<uint16_t>();
+        auto base_tag_count = tag_list_dis.read<uint16_t>();
 
         axis.baseline_tags.resize(base_tag_count);
 
         for (auto& tags : axis.baseline_tags)
         {
-            dis.read<uint8_t>(tags.data(), 4);
+            tag_list_dis.read<uint8_t>(tags.data(), 4);
         }
     }
 
     // BaseScriptList table
     {
-        auto lock = dis.seek_lock(table_begin + base_script_list_offset);
-        auto table_begin = dis.tell();
+        auto script_list_dis = dis.at(table_begin + base_script_list_offset);
+        auto table_begin = script_list_dis.tell();
 
         // baseScriptCount
-        auto base_script_count = dis.read<uint16_t>();
+        auto base_script_count = script_list_dis.read<uint16_t>();
 
         axis.script_records.resize(base_script_count);
         for (auto& script : axis.script_records)
         {
             // baseScriptTag
-            dis.read<uint8_t>(script.tag.data(), 4);
+            script_list_dis.read<uint8_t>(script.tag.data(), 4);
 
             // baseScriptOffset
             // Offset to BaseScript table, from beginning of BaseScriptList
-            std::streamoff script_offset = dis.read<uint16_t>();
+            std::size_t script_offset = script_list_dis.read<uint16_t>();
 
             // BaseScript Table
-            auto lock = dis.seek_lock(table_begin + script_offset);
-            auto base_script_begin = dis.tell();
+            auto script_dis = script_list_dis.at(table_begin + script_offset);
+            auto base_script_begin = script_dis.tell();
 
             // baseValuesOffset
-            std::streamoff base_values_offset = dis.read<uint16_t>();
+            std::size_t base_values_offset = script_dis.read<uint16_t>();
             if (base_values_offset)
             {
-                auto lock
-                    = dis.seek_lock(base_script_begin + base_values_offset);
-                auto base_values_begin = dis.tell();
+                auto values_dis
+                    = script_dis.at(base_script_begin + base_values_offset);
+                auto base_values_begin = values_dis.tell();
 
                 // defaultBaselineIndex
-                script.base_values.default_baseline_idx = dis.read<uint16_t>();
+                script.base_values.default_baseline_idx
+                    = values_dis.read<uint16_t>();
 
                 // baseCoordCount
-                auto base_coord_count = dis.read<uint16_t>();
+                auto base_coord_count = values_dis.read<uint16_t>();
                 script.base_values.coords.resize(base_coord_count);
                 for (auto& coord : script.base_values.coords)
                 {
-                    std::streamoff base_coord_off = dis.read<uint16_t>();
-                    auto           lock
-                        = dis.seek_lock(base_values_begin + base_coord_off);
+                    std::size_t base_coord_off = values_dis.read<uint16_t>();
+                    auto        coord_dis
+                        = values_dis.at(base_values_begin + base_coord_off);
 
-                    auto format = dis.read<uint16_t>();
+                    auto format = coord_dis.read<uint16_t>();
                     if (format == 1)
                     {
-                        coord.coordinate = dis.read<int16_t>();
+                        coord.coordinate = coord_dis.read<int16_t>();
                     }
                     else
                     {
-                        throw std::runtime_error(
+                        coord_dis.fail(
+                            ParseError::Code::unsupported,
                             "Unsupported BaseCoord format");
+                        return axis;
                     }
                 }
             }
             else
             {
-                throw std::runtime_error("baseValues is not present");
+                script_dis.fail(
+                    ParseError::Code::bad_value, "baseValues is not present");
+                return axis;
             }
 
             // defaultMinMaxOffset
-            std::streamoff default_min_max_offset = dis.read<uint16_t>();
+            std::size_t default_min_max_offset = script_dis.read<uint16_t>();
             if (default_min_max_offset)
             {
-                throw std::runtime_error("defaultMinMaxOffset unimplemented");
+                script_dis.fail(
+                    ParseError::Code::unsupported,
+                    "defaultMinMaxOffset unimplemented");
+                return axis;
             }
 
             // baseLangSysCount
-            auto base_langsys_count = dis.read<uint16_t>();
+            auto base_langsys_count = script_dis.read<uint16_t>();
             if (base_langsys_count)
             {
-                throw std::runtime_error("baseLangSys unimplemented");
+                script_dis.fail(
+                    ParseError::Code::unsupported, "baseLangSys unimplemented");
+                return axis;
             }
         }
     }
@@ -114,25 +124,27 @@ BaseTable::Axis parse_axis(InputBuffer& dis)
 }
 }
 
-void BaseTable::parse(InputBuffer& dis)
+void BaseTable::parse(BufferView& dis)
 {
     auto beginning = dis.tell();
 
     // Major version of the BASE table = 1
     auto major = dis.read<uint16_t>();
     if (major != 1)
-        throw std::runtime_error("Unrecognized BASE table major version");
+        return dis.fail(
+            ParseError::Code::unsupported,
+            "Unrecognized BASE table major version");
 
     // Minor version of the BASE table
     auto version_minor = dis.read<uint16_t>();
 
     // Offset to horizontal Axis table,
     // from beginning of BASE table (may be NULL)
-    std::streamoff horiz_axis_offset = dis.read<uint16_t>();
+    std::size_t horiz_axis_offset = dis.read<uint16_t>();
 
     // Offset to vertical Axis table,
     // from beginning of BASE table (may be NULL)
-    std::streamoff vert_axis_offset = dis.read<uint16_t>();
+    std::size_t vert_axis_offset = dis.read<uint16_t>();
 
     // Offset to Item Variation Store table,
     // from beginning of BASE table (may be null)
@@ -144,19 +156,21 @@ void BaseTable::parse(InputBuffer& dis)
 
     if (horiz_axis_offset)
     {
-        auto lock = dis.seek_lock(beginning + horiz_axis_offset);
-        horiz_axis = parse_axis(dis);
+        auto axis_dis = dis.at(beginning + horiz_axis_offset);
+        horiz_axis = parse_axis(axis_dis);
     }
 
     if (vert_axis_offset)
     {
-        auto lock = dis.seek_lock(beginning + vert_axis_offset);
-        vert_axis = parse_axis(dis);
+        auto axis_dis = dis.at(beginning + vert_axis_offset);
+        vert_axis = parse_axis(axis_dis);
     }
 
     if (item_var_store_offset)
     {
-        throw std::runtime_error("Item Variation Store table unimplemented");
+        return dis.fail(
+            ParseError::Code::unsupported,
+            "Item Variation Store table unimplemented");
     }
 }
 
@@ -48,7 +48,7 @@ public:
 
 public:
     BaseTable();
-    virtual void parse(InputBuffer& dis) override;
+    virtual void parse(BufferView& dis) override;
     virtual void compile(OutputBuffer& out) const override;
     virtual bool operator==(OTFTable const& rhs) const noexcept override;
 
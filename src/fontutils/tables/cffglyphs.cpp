@@ -0,0 +1,454 @@
+#include "cffglyphs.hpp"
+
+#include "../csparser.hpp"
+#include "../parallel.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace geul
+{
+
+constexpr std::size_t CFFGlyphs::default_cache_size;
+
+CFFGlyphs::CFFGlyphs()
+    : cache_(std::make_unique<Cache>())
+{}
+
+CFFGlyphs::CFFGlyphs(std::shared_ptr<Source const> source)
+    : source_(std::move(source))
+    , size_(source_->charstrings.size())
+    , num_source_(size_)
+    , cache_(std::make_unique<Cache>())
+{}
+
+CFFGlyphs::CFFGlyphs(CFFGlyphs const& rhs)
+    : source_(rhs.source_)
+    , size_(rhs.size_)
+    , num_source_(rhs.num_source_)
+    , cache_(std::make_unique<Cache>())
+{
+    cache_->capacity = rhs.cache_size();
+
+    // Edited glyphs are copied, not shared with `rhs`
+    for (auto const& edit : rhs.edits_)
+        edits_.emplace(edit.first, std::make_shared<Glyph>(*edit.second));
+
+    auto lock = rhs.lock_hashes();
+    hashes_ = rhs.hashes_;
+    hashed_ = rhs.hashed_;
+}
+
+CFFGlyphs& CFFGlyphs::operator=(CFFGlyphs const& rhs)
+{
+    if (this != &rhs)
+        *this = CFFGlyphs(rhs);
+    return *this;
+}
+
+std::size_t CFFGlyphs::size() const noexcept
+{
+    return size_;
+}
+
+void CFFGlyphs::resize(std::size_t size)
+{
+    for (auto it = edits_.begin(); it != edits_.end();)
+    {
+        if (it->first >= size)
+            it = edits_.erase(it);
+        else
+            ++it;
+    }
+    for (auto gid = size_; gid < size; ++gid)
+        edits_.emplace(gid, std::make_shared<Glyph>());
+
+    size_ = size;
+    num_source_ = std::min(num_source_, size);
+    if (cache_)
+    {
+        std::lock_guard<std::mutex> lock(cache_->mutex);
+        cache_->recent.clear();
+        cache_->index.clear();
+    }
+}
+
+void CFFGlyphs::push_back(Glyph glyph)
+{
+    edits_.emplace(size_, std::make_shared<Glyph>(std::move(glyph)));
+    ++size_;
+}
+
+std::shared_ptr<Glyph const> CFFGlyphs::get(std::size_t gid) const
+{
+    if (gid >= size_)
+        throw std::out_of_range("Glyph ID out of range");
+
+    auto edit = edits_.find(gid);
+    if (edit != edits_.end())
+        return edit->second;
+
+    if (!cache_)
+        return std::make_shared<Glyph const>(decode(gid));
+
+    auto& cache = *cache_;
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto                        it = cache.index.find(gid);
+        if (it != cache.index.end())
+        {
+            cache.recent.splice(cache.recent.begin(), cache.recent, it->second);
+            return it->second->second;
+        }
+    }
+
+    // Decoded without holding the lock, so that readers of different
+    // glyphs do not wait for each other
+    auto glyph = std::make_shared<Glyph const>(decode(gid));
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.capacity == 0 || cache.index.count(gid))
+        return glyph;
+    cache.recent.emplace_front(gid, glyph);
+    cache.index.emplace(gid, cache.recent.begin());
+    while (cache.recent.size() > cache.capacity)
+    {
+        cache.index.erase(cache.recent.back().first);
+        cache.recent.pop_back();
+    }
+    return glyph;
+}
+
+Glyph& CFFGlyphs::at(std::size_t gid)
+{
+    if (gid >= size_)
+        throw std::out_of_range("Glyph ID out of range");
+
+    auto edit = edits_.find(gid);
+    if (edit == edits_.end())
+        edit = edits_.emplace(gid, std::make_shared<Glyph>(*get(gid))).first;
+    return *edit->second;
+}
+
+void CFFGlyphs::decode_all(unsigned num_threads, ParseError* error)
+{
+    std::vector<std::shared_ptr<Glyph const>> decoded(num_source_);
+    if (!decode_source(num_threads, error, &decoded))
+        return;
+
+    if (!cache_)
+        cache_ = std::make_unique<Cache>();
+
+    auto&                       cache = *cache_;
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.capacity = std::max(cache.capacity, size_);
+    for (auto gid = 0u; gid < num_source_; ++gid)
+    {
+        if (decoded[gid] && !cache.index.count(gid))
+        {
+            cache.recent.emplace_back(gid, std::move(decoded[gid]));
+            cache.index.emplace(gid, std::prev(cache.recent.end()));
+        }
+    }
+}
+
+void CFFGlyphs::validate(unsigned num_threads, ParseError* error) const
+{
+    decode_source(num_threads, error, nullptr);
+}
+
+bool CFFGlyphs::decode_source(
+    unsigned                                   num_threads,
+    ParseError*                                error,
+    std::vector<std::shared_ptr<Glyph const>>* decoded) const
+{
+    // Glyphs are decoded in chunks of consecutive IDs, each stopping at
+    // its first error, so that the lowest chunk with an error has the
+    // error of the lowest glyph
+    constexpr std::size_t chunk_size = 256;
+
+    auto const num_chunks = (num_source_ + chunk_size - 1) / chunk_size;
+    std::vector<ParseError> errors(num_chunks);
+    parallel_for(num_chunks, num_threads, [&](std::size_t chunk) {
+        auto first = chunk * chunk_size;
+        auto last = std::min(first + chunk_size, num_source_);
+        for (auto gid = first; gid < last; ++gid)
+        {
+            if (edited(gid))
+                continue;
+
+            auto& chunk_error = errors[chunk];
+            auto  glyph = decode(gid, &chunk_error);
+            if (chunk_error)
+            {
+                auto cs = source_->charstrings[gid];
+                chunk_error.tag = "CFF ";
+                chunk_error.offset
+                    = source_->offset + (cs.data - source_->data.data.get());
+                return;
+            }
+            if (decoded)
+            {
+                (*decoded)[gid]
+                    = std::make_shared<Glyph const>(std::move(glyph));
+            }
+        }
+    });
+
+    for (auto& chunk_error : errors)
+    {
+        if (!chunk_error)
+            continue;
+        if (!error)
+            throw std::runtime_error(chunk_error.message);
+        if (!*error)
+            *error = std::move(chunk_error);
+        return false;
+    }
+    return true;
+}
+
+bool CFFGlyphs::edited(std::size_t gid) const
+{
+    return edits_.count(gid) != 0;
+}
+
+bool CFFGlyphs::dirty(std::size_t gid) const
+{
+    if (gid >= num_source_)
+        return true;
+
+    auto edit = edits_.find(gid);
+    if (edit == edits_.end())
+        return false;
+
+    // the glyph handed out was usually cached when it was decoded
+    auto original = cached(gid);
+    if (!original)
+    {
+        ParseError error;
+        auto       glyph = decode(gid, &error);
+        if (error)
+            return true;
+        original = std::make_shared<Glyph const>(std::move(glyph));
+    }
+    return edit->second->width != original->width
+           || !(edit->second->paths == original->paths);
+}
+
+ByteSpan CFFGlyphs::charstring(std::size_t gid) const
+{
+    if (dirty(gid))
+        return ByteSpan();
+    return source_->charstrings[gid];
+}
+
+CFFGlyphs::Source const* CFFGlyphs::source() const noexcept
+{
+    return source_.get();
+}
+
+std::size_t CFFGlyphs::cache_size() const noexcept
+{
+    return cache_ ? cache_->capacity : default_cache_size;
+}
+
+void CFFGlyphs::set_cache_size(std::size_t size)
+{
+    if (!cache_)
+        cache_ = std::make_unique<Cache>();
+
+    auto&                       cache = *cache_;
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.capacity = size;
+    while (cache.recent.size() > size)
+    {
+        cache.index.erase(cache.recent.back().first);
+        cache.recent.pop_back();
+    }
+}
+
+uint64_t CFFGlyphs::hash(std::size_t gid) const
+{
+    if (gid >= size_)
+        throw std::out_of_range("Glyph ID out of range");
+
+    auto edit = edits_.find(gid);
+    if (edit != edits_.end())
+        return edit->second->hash();
+
+    // Charstrings never change, so neither do their hashes
+    {
+        auto lock = lock_hashes();
+        if (hashed_.size() < num_source_)
+        {
+            hashes_.resize(num_source_);
+            hashed_.resize(num_source_);
+        }
+        if (hashed_[gid])
+            return hashes_[gid];
+    }
+
+    // Cached glyphs are shared with other readers, so the hash is cached
+    // in a copy rather than in the glyph
+    auto glyph = cached(gid);
+    auto hash = glyph ? Glyph(*glyph).hash() : decode(gid).hash();
+
+    auto lock = lock_hashes();
+    hashes_[gid] = hash;
+    hashed_[gid] = true;
+    return hash;
+}
+
+void CFFGlyphs::invalidate_hashes() noexcept
+{
+    for (auto& edit : edits_)
+        edit.second->invalidate_hash();
+}
+
+bool CFFGlyphs::operator==(CFFGlyphs const& rhs) const noexcept
+{
+    if (size_ != rhs.size_)
+        return false;
+
+    auto same = same_sources(rhs);
+    for (auto gid = 0u; gid < size_; ++gid)
+        if (!equal(gid, rhs, same))
+            return false;
+    return true;
+}
+
+std::vector<std::size_t> CFFGlyphs::differences(CFFGlyphs const& rhs) const
+{
+    std::vector<std::size_t> gids;
+
+    auto same = same_sources(rhs);
+    for (auto gid = 0u; gid < std::max(size_, rhs.size_); ++gid)
+        if (gid >= size_ || gid >= rhs.size_ || !equal(gid, rhs, same))
+            gids.push_back(gid);
+    return gids;
+}
+
+Glyph CFFGlyphs::decode(std::size_t gid, ParseError* error) const
+{
+    auto const& source = *source_;
+    auto        fd = source.fd_select[gid];
+    return parse_charstring(
+        source.charstrings[gid],
+        source.gsubrs,
+        source.lsubrs[fd],
+        source.default_width_x[fd],
+        source.nominal_width_x[fd],
+        error);
+}
+
+std::shared_ptr<Glyph const> CFFGlyphs::cached(std::size_t gid) const
+{
+    if (!cache_)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(cache_->mutex);
+    auto                        it = cache_->index.find(gid);
+    return it != cache_->index.end() ? it->second->second : nullptr;
+}
+
+Glyph const& CFFGlyphs::glyph(std::size_t gid, Glyph& scratch) const
+{
+    auto edit = edits_.find(gid);
+    if (edit != edits_.end())
+        return *edit->second;
+    scratch = decode(gid);
+    return scratch;
+}
+
+ByteSpan CFFGlyphs::unedited(std::size_t gid) const
+{
+    if (gid < num_source_ && !edited(gid))
+        return source_->charstrings[gid];
+    return ByteSpan();
+}
+
+bool CFFGlyphs::known_hash(std::size_t gid, uint64_t& hash) const
+{
+    auto edit = edits_.find(gid);
+    if (edit != edits_.end())
+    {
+        hash = edit->second->hash();
+        return true;
+    }
+
+    auto lock = lock_hashes();
+    if (gid >= hashed_.size() || !hashed_[gid])
+        return false;
+    hash = hashes_[gid];
+    return true;
+}
+
+std::unique_lock<std::mutex> CFFGlyphs::lock_hashes() const
+{
+    if (!cache_)
+        return std::unique_lock<std::mutex>();
+    return std::unique_lock<std::mutex>(cache_->mutex);
+}
+
+std::vector<char> CFFGlyphs::same_sources(CFFGlyphs const& rhs) const
+{
+    if (!source_ || !rhs.source_ || source_ == rhs.source_)
+        return {};
+
+    auto const&       lhs_source = *source_;
+    auto const&       rhs_source = *rhs.source_;
+    auto const        num_rhs_fds = rhs_source.lsubrs.size();
+    std::vector<char> same(lhs_source.lsubrs.size() * num_rhs_fds);
+    if (lhs_source.gsubrs != rhs_source.gsubrs)
+        return same;
+
+    for (auto i = 0u; i < lhs_source.lsubrs.size(); ++i)
+    {
+        for (auto j = 0u; j < num_rhs_fds; ++j)
+        {
+            same[i * num_rhs_fds + j]
+                = lhs_source.lsubrs[i] == rhs_source.lsubrs[j]
+                  && lhs_source.default_width_x[i]
+                         == rhs_source.default_width_x[j]
+                  && lhs_source.nominal_width_x[i]
+                         == rhs_source.nominal_width_x[j];
+        }
+    }
+    return same;
+}
+
+bool CFFGlyphs::equal(
+    std::size_t              gid,
+    CFFGlyphs const&         rhs,
+    std::vector<char> const& same) const noexcept
+{
+    try
+    {
+        auto lhs_cs = unedited(gid);
+        auto rhs_cs = rhs.unedited(gid);
+        if (lhs_cs.size && rhs_cs.size && lhs_cs == rhs_cs)
+        {
+            if (source_ == rhs.source_)
+                return true;
+            auto lhs_fd = source_->fd_select[gid];
+            auto rhs_fd = rhs.source_->fd_select[gid];
+            if (same[lhs_fd * rhs.source_->lsubrs.size() + rhs_fd])
+                return true;
+        }
+
+        uint64_t lhs_hash, rhs_hash;
+        if (known_hash(gid, lhs_hash) && rhs.known_hash(gid, rhs_hash)
+            && lhs_hash != rhs_hash)
+            return false;
+
+        Glyph lhs_scratch, rhs_scratch;
+        return glyph(gid, lhs_scratch) == rhs.glyph(gid, rhs_scratch);
+    }
+    catch (std::exception const&)
+    {
+        return false;
+    }
+}
+}
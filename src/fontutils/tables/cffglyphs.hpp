@@ -0,0 +1,204 @@
+#ifndef TABLES_CFF_GLYPHS_HPP
+#define TABLES_CFF_GLYPHS_HPP
+
+#include "../buffer.hpp"
+#include "../glyph.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace geul
+{
+
+/// Glyphs of a CFF font, kept as the charstrings they were read from
+/// and decoded when they are first used.
+/// Glyphs that are only read are decoded into a bounded cache of the
+/// most recently read ones. Glyphs handed out for editing stay decoded,
+/// and only they are encoded again on compile.
+class CFFGlyphs
+{
+public:
+    /// Charstrings read from a CFF table and what they are decoded with
+    struct Source
+    {
+        /// Bytes the charstrings point into, and their offset from the
+        /// beginning of the input for errors
+        SharedBytes data;
+        std::size_t offset = 0;
+
+        /// Charstring of each glyph
+        std::vector<ByteSpan> charstrings;
+
+        /// Font dict of each glyph
+        std::vector<uint8_t> fd_select;
+
+        /// Subroutines, pointing into `data` like the charstrings
+        std::vector<ByteSpan> gsubrs;
+
+        /// Subroutines and widths of each font dict
+        std::vector<std::vector<ByteSpan>> lsubrs;
+        std::vector<int>                   default_width_x;
+        std::vector<int>                   nominal_width_x;
+    };
+
+    static constexpr std::size_t default_cache_size = 1024;
+
+public:
+    CFFGlyphs();
+
+    /// Glyphs decoded on demand from `source`
+    explicit CFFGlyphs(std::shared_ptr<Source const> source);
+
+    CFFGlyphs(CFFGlyphs const& rhs);
+    CFFGlyphs(CFFGlyphs&&) = default;
+    CFFGlyphs& operator=(CFFGlyphs const& rhs);
+    CFFGlyphs& operator=(CFFGlyphs&&) = default;
+
+    std::size_t size() const noexcept;
+
+    /// Remove the glyphs from `size` on, or add empty glyphs
+    void resize(std::size_t size);
+
+    void push_back(Glyph glyph);
+
+    /// Glyph `gid` for reading, kept alive by the pointer. Glyphs that are
+    /// not being edited are decoded into the cache, and outlive being
+    /// evicted. Edited glyphs show later edits, and outlive being removed
+    /// along with these glyphs. Throws std::runtime_error on a malformed
+    /// charstring.
+    std::shared_ptr<Glyph const> get(std::size_t gid) const;
+
+    /// Glyph `gid` for editing. It is decoded once and kept, and is
+    /// encoded from its paths on compile from then on.
+    /// Throws std::out_of_range for an unknown glyph.
+    Glyph& at(std::size_t gid);
+
+    /// Decode every glyph that is not edited on up to `num_threads`
+    /// threads, and keep them all for reading by raising the cache size.
+    /// A malformed charstring is reported like decoding the glyphs one by
+    /// one would, at the beginning of the charstring of the lowest such
+    /// glyph: to `error` when given, and by throwing std::runtime_error
+    /// otherwise. No glyph is kept then.
+    void decode_all(unsigned num_threads = 1, ParseError* error = nullptr);
+
+    /// Decode every glyph that is not edited like decode_all() does, to
+    /// report malformed charstrings the same way, without keeping any
+    void validate(unsigned num_threads = 1, ParseError* error = nullptr)
+        const;
+
+    /// Whether glyph `gid` has been handed out for editing or added
+    bool edited(std::size_t gid) const;
+
+    /// Whether glyph `gid` has to be encoded from its paths: it was added,
+    /// or edited into paths or a width other than those of its
+    /// charstring. Edited glyphs are decoded again to tell.
+    bool dirty(std::size_t gid) const;
+
+    /// Charstring glyph `gid` was read from, or an empty span when it is
+    /// dirty
+    ByteSpan charstring(std::size_t gid) const;
+
+    /// What the charstrings were read from, or null
+    Source const* source() const noexcept;
+
+    /// Most glyphs kept decoded for reading
+    std::size_t cache_size() const noexcept;
+    void        set_cache_size(std::size_t size);
+
+    /// Hash of glyph `gid`, the same for glyphs that compare equal.
+    /// Glyphs that are not edited are decoded once to be hashed, and may
+    /// be hashed from several threads.
+    uint64_t hash(std::size_t gid) const;
+
+    /// Forget the hashes of the edited glyphs
+    void invalidate_hashes() noexcept;
+
+    /// Glyphs compare equal when their widths and paths do. Charstrings
+    /// that are the same bytes decoded alike are not decoded, and glyphs
+    /// that fail to decode differ from all others.
+    bool operator==(CFFGlyphs const& rhs) const noexcept;
+
+    /// IDs of the glyphs that differ from those of `rhs`, including those
+    /// in one of them only
+    std::vector<std::size_t> differences(CFFGlyphs const& rhs) const;
+
+private:
+    /// Glyph `gid` decoded from its charstring. Errors are recorded in
+    /// `error` when given, and thrown otherwise.
+    Glyph decode(std::size_t gid, ParseError* error = nullptr) const;
+
+    /// Decode the glyphs that are not edited into `decoded` when given.
+    /// Returns false after reporting the error of the lowest malformed
+    /// glyph.
+    bool decode_source(
+        unsigned                                   num_threads,
+        ParseError*                                error,
+        std::vector<std::shared_ptr<Glyph const>>* decoded) const;
+
+    /// Glyph `gid` if it is in the cache, without making it more recent
+    std::shared_ptr<Glyph const> cached(std::size_t gid) const;
+
+    /// The edited glyph `gid`, or the glyph decoded into `scratch`
+    Glyph const& glyph(std::size_t gid, Glyph& scratch) const;
+
+    /// Charstring of glyph `gid` if it is not edited
+    ByteSpan unedited(std::size_t gid) const;
+
+    /// Hash of glyph `gid` when it is cheap to get
+    bool known_hash(std::size_t gid, uint64_t& hash) const;
+
+    /// Lock of the cache, which also guards the hashes of the source
+    std::unique_lock<std::mutex> lock_hashes() const;
+
+    /// Whether charstrings of each font dict here and of each font dict
+    /// of `rhs` call the same subroutines with the same widths, row by
+    /// row. Empty when both have the same source or either has none.
+    std::vector<char> same_sources(CFFGlyphs const& rhs) const;
+
+    /// Whether glyph `gid` is the same here and in `rhs`
+    bool equal(
+        std::size_t              gid,
+        CFFGlyphs const&         rhs,
+        std::vector<char> const& same) const noexcept;
+
+    /// Most recently read glyphs, shared by concurrent readers
+    struct Cache
+    {
+        using Entry = std::pair<std::size_t, std::shared_ptr<Glyph const>>;
+        using Entries = std::list<Entry>;
+
+        std::mutex  mutex;
+        std::size_t capacity = default_cache_size;
+
+        // Most recent first, and where each glyph is in it
+        Entries                                            recent;
+        std::unordered_map<std::size_t, Entries::iterator> index;
+    };
+
+    std::shared_ptr<Source const> source_;
+
+    // Glyphs from `num_source_` on are not in the source
+    std::size_t size_ = 0;
+    std::size_t num_source_ = 0;
+
+    // Edited and added glyphs, which take the place of their charstrings,
+    // shared with the readers they were handed out to
+    std::unordered_map<std::size_t, std::shared_ptr<Glyph>> edits_;
+
+    std::unique_ptr<Cache> cache_;
+
+    // Hashes of the glyphs decoded from the source, under the lock of the
+    // cache
+    mutable std::vector<uint64_t> hashes_;
+    mutable std::vector<bool>     hashed_;
+};
+}
+
+#endif
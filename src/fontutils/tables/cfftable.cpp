@@ -1,5 +1,6 @@
 #include "cfftable.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <sstream>
 #include <typeinfo>
@@ -7,8 +8,11 @@
 #include <vector>
 
 #include "../cffutils.hpp"
+#include "../checksum.hpp"
 #include "../csparser.hpp"
+#include "../parallel.hpp"
 #include "../stdstr.hpp"
+#include "../subroutinizer.hpp"
 
 namespace geul
 {
@@ -17,13 +21,15 @@ CFFTable::CFFTable()
     : OTFTable(tag)
 {}
 
-void CFFTable::parse(InputBuffer& dis)
+void CFFTable::parse(BufferView& dis)
 {
     auto const beginning = dis.tell();
 
     auto major = dis.read<uint8_t>();
     if (major != 1)
-        throw std::runtime_error("Unrecognized major CFF table version");
+        return dis.fail(
+            ParseError::Code::unsupported,
+            "Unrecognized major CFF table version");
 
     // minor version (ignored)
     dis.read<uint8_t>();
@@ -34,54 +40,63 @@ void CFFTable::parse(InputBuffer& dis)
     dis.read<uint8_t>();
 
     // Seek to name index
-    dis.seek(beginning + std::streamoff(header_size));
+    dis.seek(beginning + header_size);
 
     auto name_index = parse_index(dis);
-    auto num_fonts = name_index.count;
+    auto num_fonts = name_index.size();
     fonts.resize(num_fonts);
 
     for (auto name : name_index)
-    {
-        auto lock = dis.seek_lock(name.pos);
-        fonts[name.index].name = dis.read_string(name.length);
-    }
+        fonts[name.index].name = dis.at(name.pos).read_string(name.length);
 
     // parse top dict index
     auto dict_index = parse_index(dis);
+    if (dict_index.size() != num_fonts)
+        return dis.fail(
+            ParseError::Code::bad_value,
+            "Top DICT INDEX does not match Name INDEX");
 
     // parse sid strings index
     auto                     string_index = parse_index(dis);
     std::vector<std::string> sid{ standard_strings.begin(),
                                   standard_strings.end() };
     for (auto str : string_index)
-    {
-        auto lock = dis.seek_lock(str.pos);
-        sid.push_back(dis.read_string(str.length));
-    }
+        sid.push_back(dis.at(str.pos).read_string(str.length));
+
+    // string of a SID operand
+    auto sid_string = [&sid](BufferView& dis, CFFToken token) {
+        auto idx = std::size_t(token.to_int());
+        if (idx >= sid.size())
+        {
+            dis.fail(ParseError::Code::bad_value, "SID out of range");
+            return std::string();
+        }
+        return sid[idx];
+    };
 
     // indexviews for charstrings
     std::vector<IndexView> cs_indices;
 
     // local subroutines
-    std::vector<std::vector<std::vector<std::string>>> lsubrs;
+    std::vector<std::vector<std::vector<ByteSpan>>> lsubrs;
 
     // parse top dict
     for (auto dict : dict_index)
     {
-        auto  lock = dis.seek_lock(dict.pos);
+        auto  dict_dis = dis.at(dict.pos);
         auto& font = fonts[dict.index];
         auto& fontinfo = font.fontinfo;
 
-        std::streampos charset_offset = -1;
-        std::streampos charstrings_offset = -1;
-        std::streampos fdarray_offset = -1;
-        std::streampos fdselect_offset = -1;
+        std::streamoff charset_offset = -1;
+        std::streamoff charstrings_offset = -1;
+        std::streamoff fdarray_offset = -1;
+        std::streamoff fdselect_offset = -1;
 
         std::vector<CFFToken> operands;
         bool                  is_first_op = true;
-        while (dis.tell() < dict.pos + std::streamoff(dict.length))
+        while (dict_dis.tell() < dict.pos + dict.length)
         {
-            auto token = next_token(dis);
+            auto token = next_token(dict_dis);
             if (token.get_type() & CFFToken::number)
             {
                 operands.push_back(token);
@@ -97,98 +112,113 @@ void CFFTable::parse(InputBuffer& dis)
             if (is_first_op)
             {
                 if (op != CFFToken::Op::ros)
-                    throw std::runtime_error("Font is not CID-keyed.");
+                    return dict_dis.fail(
+                        ParseError::Code::unsupported,
+                        "Font is not CID-keyed.");
                 is_first_op = false;
             }
 
             if (op == CFFToken::Op::version)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'version' operands != 1");
-                fontinfo.version = sid.at(operands[0].to_int());
+                fontinfo.version = sid_string(dict_dis, operands[0]);
             }
             else if (op == CFFToken::Op::notice)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'notice' operands != 1");
-                fontinfo.notice = sid.at(operands[0].to_int());
+                fontinfo.notice = sid_string(dict_dis, operands[0]);
             }
             else if (op == CFFToken::Op::copyright)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'copyright' operands != 1");
-                fontinfo.copyright = sid.at(operands[0].to_int());
+                fontinfo.copyright = sid_string(dict_dis, operands[0]);
             }
             else if (op == CFFToken::Op::fullname)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'fullname' operands != 1");
-                fontinfo.fullname = sid.at(operands[0].to_int());
+                fontinfo.fullname = sid_string(dict_dis, operands[0]);
             }
             else if (op == CFFToken::Op::familyname)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'familyname' operands != 1");
-                fontinfo.familyname = sid.at(operands[0].to_int());
+                fontinfo.familyname = sid_string(dict_dis, operands[0]);
             }
             else if (op == CFFToken::Op::weight)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'weight' operands != 1");
-                fontinfo.weight = sid.at(operands[0].to_int());
+                fontinfo.weight = sid_string(dict_dis, operands[0]);
             }
             else if (op == CFFToken::Op::isfixedpitch)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'isfixedpitch' operands != 1");
                 fontinfo.is_fixed_pitch = operands[0].to_int();
             }
             else if (op == CFFToken::Op::italicangle)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'italicangle' operands != 1");
                 fontinfo.italic_angle = operands[0].to_int();
             }
             else if (op == CFFToken::Op::underlineposition)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'underlineposition' operands != 1");
                 fontinfo.underline_position = operands[0].to_int();
             }
             else if (op == CFFToken::Op::underlinethickness)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'underlinethickness' operands != 1");
                 fontinfo.underline_thickness = operands[0].to_int();
             }
             else if (op == CFFToken::Op::painttype)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'painttype' operands != 1");
                 fontinfo.paint_type = operands[0].to_int();
             }
             else if (op == CFFToken::Op::charstringtype)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'isfixedpitch' operands != 1");
                 fontinfo.charstring_type = operands[0].to_int();
             }
             else if (op == CFFToken::Op::fontmatrix)
             {
                 if (operands.size() != 6)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'fontmatrix' operands != 6");
                 for (int i = 0; i < 6; ++i)
                     fontinfo.font_matrix[i] = operands[i].to_double();
@@ -196,14 +226,16 @@ void CFFTable::parse(InputBuffer& dis)
             else if (op == CFFToken::Op::uniqueid)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'uniqueid' operands != 1");
                 fontinfo.unique_id = operands[0].to_int();
             }
             else if (op == CFFToken::Op::fontbbox)
             {
                 if (operands.size() != 4)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'fontbbox' operands != 4");
                 for (int i = 0; i < 4; ++i)
                     fontinfo.font_bbox[i] = operands[i].to_int();
@@ -211,7 +243,8 @@ void CFFTable::parse(InputBuffer& dis)
             else if (op == CFFToken::Op::strokewidth)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'strokewidth' operands != 1");
                 fontinfo.stroke_width = operands[0].to_int();
             }
@@ -223,124 +256,152 @@ void CFFTable::parse(InputBuffer& dis)
             else if (op == CFFToken::Op::charset)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'charset' operands != 1");
                 auto charset = operands[0].to_int();
                 if (charset > 2)
-                    charset_offset = beginning + std::streampos(charset);
+                    charset_offset = beginning + charset;
                 else // TODO: implement standard charset
-                    throw std::runtime_error("standard charset unimplemented");
+                    return dict_dis.fail(
+                        ParseError::Code::unsupported,
+                        "standard charset unimplemented");
             }
             else if (op == CFFToken::Op::encoding)
             {
-                throw std::runtime_error("invalid operand 'encoding'");
+                return dict_dis.fail(
+                    ParseError::Code::unsupported,
+                    "invalid operand 'encoding'");
             }
             else if (op == CFFToken::Op::charstrings)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'charstrings' operands != 1");
                 charstrings_offset
-                    = beginning + std::streamoff(operands[0].to_int());
+                    = beginning + operands[0].to_int();
             }
             else if (op == CFFToken::Op::syntheticbase)
             {
-                throw std::runtime_error("invalid operand 'syntheticbase'");
+                return dict_dis.fail(
+                    ParseError::Code::unsupported,
+                    "invalid operand 'syntheticbase'");
             }
             else if (op == CFFToken::Op::postscript)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'postscript operands != 1");
-                fontinfo.postscript = sid.at(operands[0].to_int());
+                fontinfo.postscript = sid_string(dict_dis, operands[0]);
             }
             else if (op == CFFToken::Op::basefontname)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'basefontname' operands != 1");
-                fontinfo.basefont_name = sid.at(operands[0].to_int());
+                fontinfo.basefont_name = sid_string(dict_dis, operands[0]);
             }
             else if (op == CFFToken::Op::basefontblend)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'basefontblend' operands != 1");
                 fontinfo.basefont_blend = operands[0].to_int();
             }
             else if (op == CFFToken::Op::ros)
             {
                 if (operands.size() != 3)
-                    throw std::runtime_error("number of 'ros' operands != 3");
-                fontinfo.registry = sid.at(operands[0].to_int());
-                fontinfo.ordering = sid.at(operands[1].to_int());
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
+                        "number of 'ros' operands != 3");
+                fontinfo.registry = sid_string(dict_dis, operands[0]);
+                fontinfo.ordering = sid_string(dict_dis, operands[1]);
                 fontinfo.supplement = operands[2].to_int();
             }
             else if (op == CFFToken::Op::cidfontversion)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'cidfontversion' operands != 1");
                 fontinfo.cid_font_version = operands[0].to_double();
             }
             else if (op == CFFToken::Op::cidfontrevision)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'cidfontrevision' operands != 1");
                 fontinfo.cid_font_revision = operands[0].to_double();
             }
             else if (op == CFFToken::Op::cidfonttype)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'cidfonttype' operands != 1");
                 fontinfo.cid_font_type = operands[0].to_int();
             }
             else if (op == CFFToken::Op::cidcount)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'cidcount' operands != 1");
                 fontinfo.cid_count = operands[0].to_int();
             }
             else if (op == CFFToken::Op::uidbase)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'uidbase' operands != 1");
                 fontinfo.uid_base = operands[0].to_int();
             }
             else if (op == CFFToken::Op::fdarray)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'fdarray' operands != 1");
                 fdarray_offset
-                    = beginning + std::streamoff(operands[0].to_int());
+                    = beginning + operands[0].to_int();
             }
             else if (op == CFFToken::Op::fdselect)
             {
                 if (operands.size() != 1)
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value,
                         "number of 'fdselect' operands != 1");
                 fdselect_offset
-                    = beginning + std::streamoff(operands[0].to_int());
+                    = beginning + operands[0].to_int();
             }
             else
             {
-                throw std::runtime_error("Unknown operand in top dict.");
+                return dict_dis.fail(
+                    ParseError::Code::unsupported,
+                    "Unknown operand in top dict.");
             }
             operands.clear();
         }
+        if (dict_dis.failed())
+            return;
 
         // parse charstrings index
         if (charstrings_offset == -1)
-            throw std::runtime_error(
+            return dict_dis.fail(
+                ParseError::Code::bad_value,
                 "charstrings offset not present in top dict.");
-        dis.seek(charstrings_offset);
-        auto cs_index = parse_index(dis);
-        auto n_glyphs = cs_index.count;
+        dict_dis.seek(charstrings_offset);
+        auto cs_index = parse_index(dict_dis);
+        int  n_glyphs = cs_index.size();
+        if (n_glyphs == 0)
+            return dict_dis.fail(
+                ParseError::Code::bad_value, "CFF font has no glyphs");
         cs_indices.push_back(cs_index);
 
         // parse charset
@@ -348,20 +409,22 @@ void CFFTable::parse(InputBuffer& dis)
         font.charset[0] = 0;
 
         if (charset_offset == -1)
-            throw std::runtime_error("charset offset not present in top dict.");
-        dis.seek(charset_offset);
-        auto charset_format = dis.read<uint8_t>();
+            return dict_dis.fail(
+                ParseError::Code::bad_value,
+                "charset offset not present in top dict.");
+        dict_dis.seek(charset_offset);
+        auto charset_format = dict_dis.read<uint8_t>();
         if (charset_format == 0)
         {
             for (int i = 1; i < n_glyphs; ++i)
-                font.charset[i] = dis.read<uint16_t>();
+                font.charset[i] = dict_dis.read<uint16_t>();
         }
         else if (charset_format == 1)
         {
             for (int i = 1; i < n_glyphs;)
             {
-                auto s = dis.read<uint16_t>();
-                int  n_left = dis.read<uint8_t>();
+                auto s = dict_dis.read<uint16_t>();
+                int  n_left = dict_dis.read<uint8_t>();
                 while (i < n_glyphs && s <= s + n_left)
                     font.charset[i++] = s++;
             }
@@ -370,61 +433,69 @@ void CFFTable::parse(InputBuffer& dis)
         {
             for (int i = 1; i < n_glyphs;)
             {
-                int s = dis.read<uint16_t>();
-                int n_left = dis.read<uint16_t>();
+                int s = dict_dis.read<uint16_t>();
+                int n_left = dict_dis.read<uint16_t>();
                 int last = s + n_left;
                 while (i < n_glyphs && s <= last)
                     font.charset[i++] = s++;
             }
         }
         else
-            throw std::runtime_error("Unrecognized charset format");
+            return dict_dis.fail(
+                ParseError::Code::unsupported, "Unrecognized charset format");
 
         // parse fdselect
         font.fd_select.resize(n_glyphs);
 
         if (fdselect_offset == -1)
-            throw std::runtime_error(
+            return dict_dis.fail(
+                ParseError::Code::bad_value,
                 "fdselect offset not present in top dict.");
-        dis.seek(fdselect_offset);
-        auto fdselect_format = dis.read<uint8_t>();
+        dict_dis.seek(fdselect_offset);
+        auto fdselect_format = dict_dis.read<uint8_t>();
         if (fdselect_format == 0)
         {
             for (int i = 0; i < n_glyphs; ++i)
-                font.fd_select[i] = dis.read<uint8_t>();
+                font.fd_select[i] = dict_dis.read<uint8_t>();
         }
         else if (fdselect_format == 3)
         {
-            int n_ranges = dis.read<uint16_t>();
+            int n_ranges = dict_dis.read<uint16_t>();
             for (int i = 0; i < n_ranges; ++i)
             {
-                int  first = dis.read<uint16_t>();
-                auto fd = dis.read<uint8_t>();
-                int  end = dis.peek<uint16_t>();
+                int  first = dict_dis.read<uint16_t>();
+                auto fd = dict_dis.read<uint8_t>();
+                int  end = dict_dis.peek<uint16_t>();
+                if (end > n_glyphs)
+                    return dict_dis.fail(
+                        ParseError::Code::bad_value, "Invalid fdselect range");
                 for (int j = first; j < end; ++j)
                     font.fd_select[j] = fd;
             }
         }
         else
-            throw std::runtime_error("Unrecognized fdselect format");
+            return dict_dis.fail(
+                ParseError::Code::unsupported, "Unrecognized fdselect format");
 
         // parse fdarray
         if (fdarray_offset == -1)
-            throw std::runtime_error("fdarray offset not present in top dict.");
-        dis.seek(fdarray_offset);
-        auto fd_index = parse_index(dis);
-        font.fd_array.resize(fd_index.count);
-        lsubrs.emplace_back(fd_index.count);
+            return dict_dis.fail(
+                ParseError::Code::bad_value,
+                "fdarray offset not present in top dict.");
+        dict_dis.seek(fdarray_offset);
+        auto fd_index = parse_index(dict_dis);
+        font.fd_array.resize(fd_index.size());
+        lsubrs.emplace_back(fd_index.size());
         for (auto fditem : fd_index)
         {
             auto& font_dict = font.fd_array[fditem.index];
             int   priv_size, priv_offset = -1;
 
-            dis.seek(fditem.pos);
+            dict_dis.seek(fditem.pos);
             std::vector<CFFToken> operands;
-            while (dis.tell() < fditem.pos + std::streamoff(fditem.length))
+            while (dict_dis.tell() < fditem.pos + fditem.length)
             {
-                auto token = next_token(dis);
+                auto token = next_token(dict_dis);
                 if (token.get_type() & CFFToken::number)
                 {
                     operands.push_back(token);
@@ -436,35 +507,45 @@ void CFFTable::parse(InputBuffer& dis)
                 if (op == CFFToken::Op::fontname)
                 {
                     if (operands.size() != 1)
-                        throw std::runtime_error(
+                        return dict_dis.fail(
+                            ParseError::Code::bad_value,
                             "number of 'fontname' operands != 1");
-                    font_dict.name = sid.at(operands[0].to_int());
+                    font_dict.name = sid_string(dict_dis, operands[0]);
                 }
                 else if (op == CFFToken::Op::private_)
                 {
+                    if (operands.size() != 2)
+                        return dict_dis.fail(
+                            ParseError::Code::bad_value,
+                            "number of 'private' operands != 2");
                     priv_size = operands[0].to_int();
                     priv_offset
-                        = beginning + std::streamoff(operands[1].to_int());
+                        = beginning + operands[1].to_int();
                 }
                 else
                 {
-                    throw std::runtime_error("Unknown operand in font dict.");
+                    return dict_dis.fail(
+                        ParseError::Code::unsupported,
+                        "Unknown operand in font dict.");
                 }
                 operands.clear();
             } // font dict
+            if (dict_dis.failed())
+                return;
 
             // parse private dict
             if (priv_offset == -1)
-                throw std::runtime_error("No private dict found");
+                return dict_dis.fail(
+                    ParseError::Code::bad_value, "No private dict found");
 
             int subrs_offset = -1;
 
             operands.clear();
 
-            dis.seek(priv_offset);
-            while (int(dis.tell()) < priv_offset + priv_size)
+            dict_dis.seek(priv_offset);
+            while (int(dict_dis.tell()) < priv_offset + priv_size)
             {
-                auto token = next_token(dis);
+                auto token = next_token(dict_dis);
                 if (token.get_type() & CFFToken::number)
                 {
                     operands.push_back(token);
@@ -516,35 +597,40 @@ void CFFTable::parse(InputBuffer& dis)
                 else if (op == CFFToken::Op::bluescale)
                 {
                     if (operands.size() != 1)
-                        throw std::runtime_error(
+                        return dict_dis.fail(
+                            ParseError::Code::bad_value,
                             "number of 'bluescale' operands != 1");
                     font_dict.blue_scale = operands[0].to_double();
                 }
                 else if (op == CFFToken::Op::blueshift)
                 {
                     if (operands.size() != 1)
-                        throw std::runtime_error(
+                        return dict_dis.fail(
+                            ParseError::Code::bad_value,
                             "number of 'blueshift' operands != 1");
                     font_dict.blue_shift = operands[0].to_double();
                 }
                 else if (op == CFFToken::Op::bluefuzz)
                 {
                     if (operands.size() != 1)
-                        throw std::runtime_error(
+                        return dict_dis.fail(
+                            ParseError::Code::bad_value,
                             "number of 'bluefuzz' operands != 1");
                     font_dict.blue_fuzz = operands[0].to_double();
                 }
                 else if (op == CFFToken::Op::stdhw)
                 {
                     if (operands.size() != 1)
-                        throw std::runtime_error(
+                        return dict_dis.fail(
+                            ParseError::Code::bad_value,
                             "number of 'stdhw' operands != 1");
                     font_dict.std_hw = operands[0].to_int();
                 }
                 else if (op == CFFToken::Op::stdvw)
                 {
                     if (operands.size() != 1)
-                        throw std::runtime_error(
+                        return dict_dis.fail(
+                            ParseError::Code::bad_value,
                             "number of 'stdvw' operands != 1");
                     font_dict.std_vw = operands[0].to_int();
                 }
@@ -571,101 +657,133 @@ void CFFTable::parse(InputBuffer& dis)
                 else if (op == CFFToken::Op::forcebold)
                 {
                     if (operands.size() != 1)
-                        throw std::runtime_error(
+                        return dict_dis.fail(
+                            ParseError::Code::bad_value,
                             "number of 'forcebold' operands != 1");
                     font_dict.force_bold = operands[0].to_int();
                 }
                 else if (op == CFFToken::Op::languagegroup)
                 {
                     if (operands.size() != 1)
-                        throw std::runtime_error(
+                        return dict_dis.fail(
+                            ParseError::Code::bad_value,
                             "number of 'languagegroup' operands != 1");
                     font_dict.language_group = operands[0].to_int();
                 }
                 else if (op == CFFToken::Op::expansionfactor)
                 {
                     if (operands.size() != 1)
-                        throw std::runtime_error(
+                        return dict_dis.fail(
+                            ParseError::Code::bad_value,
                             "number of 'expansionfactor' operands != 1");
                     font_dict.expansion_factor = operands[0].to_double();
                 }
                 else if (op == CFFToken::Op::initialrandomseed)
                 {
                     if (operands.size() != 1)
-                        throw std::runtime_error(
+                        return dict_dis.fail(
+                            ParseError::Code::bad_value,
                             "number of 'initialrandomseed' operands != 1");
                     font_dict.initial_random_seed = operands[0].to_int();
                 }
                 else if (op == CFFToken::Op::subrs)
                 {
                     if (operands.size() != 1)
-                        throw std::runtime_error(
+                        return dict_dis.fail(
+                            ParseError::Code::bad_value,
                             "number of 'subrs' operands != 1");
                     subrs_offset = priv_offset + operands[0].to_int();
                 }
                 else if (op == CFFToken::Op::defaultwidthx)
                 {
                     if (operands.size() != 1)
-                        throw std::runtime_error(
+                        return dict_dis.fail(
+                            ParseError::Code::bad_value,
                             "number of 'defaultwidthx' operands != 1");
                     font_dict.default_width_x = operands[0].to_int();
                 }
                 else if (op == CFFToken::Op::nominalwidthx)
                 {
                     if (operands.size() != 1)
-                        throw std::runtime_error(
+                        return dict_dis.fail(
+                            ParseError::Code::bad_value,
                             "number of 'nominalwidthx' operands != 1");
                     font_dict.nominal_width_x = operands[0].to_int();
                 }
                 else
                 {
-                    throw std::runtime_error(
+                    return dict_dis.fail(
+                        ParseError::Code::unsupported,
                         "Unknown operand in private dict.");
                 }
                 operands.clear();
             } // private dict
+            if (dict_dis.failed())
+                return;
 
             // parse local subroutines
             if (subrs_offset != -1)
             {
-                auto lock = dis.seek_lock(subrs_offset);
-                auto subrs_index = parse_index(dis);
-                for (auto item : subrs_index)
-                {
-                    auto lock = dis.seek_lock(item.pos);
-                    lsubrs[dict.index][fditem.index].push_back(
-                        dis.read_string(item.length));
-                }
+                auto subrs_dis = dict_dis.at(subrs_offset);
+                auto  subrs_index = parse_index(subrs_dis);
+                auto& subrs = lsubrs[dict.index][fditem.index];
+                for (auto i = 0u; i < subrs_index.size(); ++i)
+                    subrs.push_back(subrs_index.span(i));
             }
         } // fdarray
     }
 
     // parse global subroutines
-    auto                     gsubr_index = parse_index(dis);
-    std::vector<std::string> gsubrs;
-    for (auto item : gsubr_index)
-    {
-        auto lock = dis.seek_lock(item.pos);
-        gsubrs.push_back(dis.read_string(item.length));
-    }
+    auto gsubr_index = parse_index(dis);
+    if (dis.failed())
+        return;
+
+    // charstrings are decoded on demand from a copy of the table,
+    // unless the table is mapped
+    auto table = dis.span();
+    auto data = dis.at(0).read_shared(dis.size());
+    auto in_data = [&](ByteSpan span) {
+        return ByteSpan{ data.data.get() + (span.data - table.data),
+                         span.size };
+    };
+
+    std::vector<ByteSpan> gsubrs;
+    for (auto i = 0u; i < gsubr_index.size(); ++i)
+        gsubrs.push_back(in_data(gsubr_index.span(i)));
 
-    // parse charstrings
     for (auto i = 0u; i < fonts.size(); ++i)
     {
         auto& font = fonts[i];
         auto& index = cs_indices[i];
-        font.glyphs.resize(index.count);
-        for (auto item : index)
+
+        auto source = std::make_shared<CFFGlyphs::Source>();
+        source->data = data;
+        source->offset = dis.input_offset();
+        source->fd_select = font.fd_select;
+        source->gsubrs = gsubrs;
+        for (auto const& subrs : lsubrs[i])
         {
-            auto lock = dis.seek_lock(item.pos);
-            int  fd_idx = font.fd_select[item.index];
-            font.glyphs[item.index] = parse_charstring(
-                dis.read_string(item.length),
-                gsubrs,
-                lsubrs[i][fd_idx],
-                font.fd_array[fd_idx].default_width_x,
-                font.fd_array[fd_idx].nominal_width_x);
+            source->lsubrs.emplace_back();
+            for (auto subr : subrs)
+                source->lsubrs.back().push_back(in_data(subr));
+        }
+        for (auto const& font_dict : font.fd_array)
+        {
+            source->default_width_x.push_back(font_dict.default_width_x);
+            source->nominal_width_x.push_back(font_dict.nominal_width_x);
+        }
+
+        source->charstrings.reserve(index.size());
+        for (auto gid = 0u; gid < index.size(); ++gid)
+        {
+            std::size_t fd_idx = font.fd_select[gid];
+            if (fd_idx >= font.fd_array.size())
+                return dis.at(index[gid].pos).fail(
+                    ParseError::Code::bad_value, "FD index out of range");
+
+            source->charstrings.push_back(in_data(index.span(gid)));
         }
+        font.glyphs = CFFGlyphs(std::move(source));
     }
 }
 
@@ -1018,57 +1136,170 @@ void write_fdsel(
     }
 }
 
+std::vector<ByteSpan> spans(std::vector<std::string> const& strings)
+{
+    std::vector<ByteSpan> items;
+    items.reserve(strings.size());
+    for (auto const& str : strings)
+        items.push_back(ByteSpan{ str.data(), str.size() });
+    return items;
+}
+
+/// Charstrings and subroutines of a font, ready to be written
+struct Encoded
+{
+    /// Charstring of each glyph, in `chunks`, in `subrs` or in the bytes
+    /// the glyphs were read from
+    std::vector<ByteSpan> charstrings;
+
+    /// Subroutines, in `found` or in the bytes the glyphs were read from
+    std::vector<ByteSpan>              gsubrs;
+    std::vector<std::vector<ByteSpan>> lsubrs;
+
+    /// Subroutines and the charstrings calling them, when they were found
+    /// on compile
+    Subroutines found;
+
+    /// Charstrings of consecutive glyphs encoded by the same task
+    std::vector<OutputBuffer> chunks;
+};
+
+/// Charstrings of each font, with subroutines when asked for.
+/// Charstrings of glyphs that are not dirty are kept along with the
+/// subroutines they call. Global subroutines are shared by all fonts, so
+/// only a single font gets new ones.
+std::vector<Encoded> encode_charstrings(CFFTable const& cff)
+{
+    constexpr std::size_t chunk_size = 256;
+
+    std::vector<Encoded> encoded(cff.fonts.size());
+    for (auto idx = 0u; idx < cff.fonts.size(); ++idx)
+    {
+        auto const& font = cff.fonts[idx];
+        auto const& glyphs = font.glyphs;
+        auto&       result = encoded[idx];
+
+        auto const num_chunks = (glyphs.size() + chunk_size - 1) / chunk_size;
+        result.charstrings.resize(glyphs.size());
+        result.chunks.resize(num_chunks);
+        std::vector<char> kept_in_chunk(num_chunks);
+        parallel_for(num_chunks, cff.num_threads, [&](std::size_t chunk) {
+            auto  first = chunk * chunk_size;
+            auto  last = std::min(first + chunk_size, glyphs.size());
+            auto& out = result.chunks[chunk];
+            for (auto gid = first; gid < last; ++gid)
+            {
+                auto& cs = result.charstrings[gid];
+                if (cff.keep_charstrings)
+                    cs = glyphs.charstring(gid);
+                if (cs.size)
+                {
+                    kept_in_chunk[chunk] = true;
+                    continue;
+                }
+
+                auto begin = out.tell();
+                // widths are those of the font dict of the glyph
+                auto glyph = glyphs.get(gid);
+                std::size_t fd
+                    = gid < font.fd_select.size() ? font.fd_select[gid] : 0;
+                if (fd < font.fd_array.size())
+                {
+                    write_charstring(
+                        out,
+                        *glyph,
+                        font.fd_array[fd].default_width_x,
+                        font.fd_array[fd].nominal_width_x);
+                }
+                else
+                    write_charstring(out, *glyph);
+                cs.size = out.tell() - begin;
+            }
+
+            // the buffer no longer grows, so it can be pointed into
+            auto data = out.view().span().data;
+            for (auto gid = first; gid < last; ++gid)
+            {
+                auto& cs = result.charstrings[gid];
+                if (!cs.data)
+                {
+                    cs.data = data;
+                    data += cs.size;
+                }
+            }
+        });
+
+        bool kept = false;
+        for (auto chunk_kept : kept_in_chunk)
+            kept = kept || chunk_kept;
+
+        if (!kept && cff.subroutinize && cff.fonts.size() == 1)
+        {
+            std::vector<std::string> charstrings;
+            charstrings.reserve(glyphs.size());
+            for (auto cs : result.charstrings)
+                charstrings.push_back(cs.str());
+            result.found = find_subroutines(
+                charstrings,
+                font.fd_select,
+                font.fd_array.size(),
+                cff.num_threads);
+
+            result.chunks.clear();
+            result.charstrings = spans(result.found.charstrings);
+            result.gsubrs = spans(result.found.gsubrs);
+            for (auto const& subrs : result.found.lsubrs)
+                result.lsubrs.push_back(spans(subrs));
+            continue;
+        }
+
+        if (kept)
+        {
+            result.gsubrs = glyphs.source()->gsubrs;
+            result.lsubrs = glyphs.source()->lsubrs;
+        }
+        result.lsubrs.resize(font.fd_array.size());
+    }
+    return encoded;
+}
+
 void write_charstrs(
     OutputBuffer&                      out,
-    CFFTable const&                    cff,
+    std::vector<Encoded> const&        encoded,
     std::streampos                     beginning,
     std::vector<std::streampos> const& offset_pos)
 {
-    int idx = 0;
-    for (auto const& font : cff.fonts)
+    for (auto idx = 0u; idx < encoded.size(); ++idx)
     {
         write_5byte_offset_at(out, offset_pos[idx], out.tell() - beginning);
-
-        write_index(out, font.glyphs.size(), [&](int i) {
-            write_charstring(out, font.glyphs[i]);
-        });
-
-        idx++;
+        write_index(out, encoded[idx].charstrings);
     }
 }
 
 void write_lsubrs(
-    OutputBuffer&                            out,
-    CFFTable const&                          cff,
-    std::vector<std::vector<std::streampos>> subr_offs,
-    std::vector<std::vector<std::streampos>> priv_beginning)
+    OutputBuffer&                                   out,
+    std::vector<Encoded> const&                     encoded,
+    std::vector<std::vector<std::streampos>> const& subr_offs,
+    std::vector<std::vector<std::streampos>> const& priv_beginning)
 {
-    int idx = 0;
-    for (auto const& font : cff.fonts)
+    for (auto idx = 0u; idx < encoded.size(); ++idx)
     {
-        int fd_idx = 0;
-        for (auto const& font_dict : font.fd_array)
+        auto const& lsubrs = encoded[idx].lsubrs;
+        for (auto fd_idx = 0u; fd_idx < lsubrs.size(); ++fd_idx)
         {
             write_5byte_offset_at(
                 out,
                 subr_offs[idx][fd_idx],
                 out.tell() - priv_beginning[idx][fd_idx]);
-
-            // write empty subrs for now
-            write_index(out, 0, nullptr);
-
-            (void)font_dict;
-
-            fd_idx++;
+            write_index(out, lsubrs[fd_idx]);
         }
-
-        idx++;
     }
 }
 
 void write_privdict(
     OutputBuffer&                                   out,
     CFFTable const&                                 cff,
+    std::vector<Encoded> const&                     encoded,
     std::streampos                                  beginning,
     std::vector<std::vector<std::streampos>> const& offset_pos)
 {
@@ -1233,12 +1464,13 @@ void write_privdict(
     }
 
     // write Local Subr INDEX
-    write_lsubrs(out, cff, subr_offs, priv_beginning);
+    write_lsubrs(out, encoded, subr_offs, priv_beginning);
 }
 
 void write_fdarray(
     OutputBuffer&                               out,
     CFFTable const&                             cff,
+    std::vector<Encoded> const&                 encoded,
     std::streampos                              beginning,
     std::vector<std::streampos> const&          offset_pos,
     std::unordered_map<std::string, int> const& sid)
@@ -1266,7 +1498,7 @@ void write_fdarray(
         idx++;
     }
 
-    write_privdict(out, cff, beginning, priv_offs);
+    write_privdict(out, cff, encoded, beginning, priv_offs);
 }
 }
 
@@ -1298,9 +1530,15 @@ void CFFTable::compile(OutputBuffer& out) const
     // write SID Strings INDEX
     write_sidindex(out, sid_map);
 
-    // write gsubr INDEX
-    // write empty index for now
-    write_index(out, 0, nullptr);
+    // write gsubr INDEX, those of the first font that has any
+    auto encoded = encode_charstrings(*this);
+    auto gsubrs = std::find_if(
+        encoded.begin(), encoded.end(), [](Encoded const& font) {
+            return !font.gsubrs.empty();
+        });
+    write_index(
+        out,
+        gsubrs != encoded.end() ? gsubrs->gsubrs : std::vector<ByteSpan>());
 
     // write Charsets
     write_charsets(out, *this, beginning, top_offsets.charset);
@@ -1309,10 +1547,11 @@ void CFFTable::compile(OutputBuffer& out) const
     write_fdsel(out, *this, beginning, top_offsets.fdsel);
 
     // write CharStrings INDEX
-    write_charstrs(out, *this, beginning, top_offsets.charstr);
+    write_charstrs(out, encoded, beginning, top_offsets.charstr);
 
     // write Font Dict Array
-    write_fdarray(out, *this, beginning, top_offsets.fdarray, sid_map);
+    write_fdarray(
+        out, *this, encoded, beginning, top_offsets.fdarray, sid_map);
 }
 
 bool CFFTable::operator==(OTFTable const& rhs) const noexcept
@@ -1323,6 +1562,37 @@ bool CFFTable::operator==(OTFTable const& rhs) const noexcept
     return fonts == other.fonts;
 }
 
+void CFFTable::invalidate_hash() noexcept
+{
+    OTFTable::invalidate_hash();
+    for (auto& font : fonts)
+        font.glyphs.invalidate_hashes();
+}
+
+uint64_t CFFTable::calculate_hash() const
+{
+    uint64_t hash = fonts.size();
+    for (auto const& font : fonts)
+    {
+        hash = content_hash(font.name.data(), font.name.size(), hash);
+        hash = content_hash(
+            reinterpret_cast<char const*>(font.charset.data()),
+            font.charset.size() * sizeof(uint16_t), hash);
+        hash = content_hash(
+            reinterpret_cast<char const*>(font.fd_select.data()),
+            font.fd_select.size(), hash);
+
+        std::vector<uint64_t> glyphs;
+        glyphs.reserve(font.glyphs.size());
+        for (auto gid = 0u; gid < font.glyphs.size(); ++gid)
+            glyphs.push_back(font.glyphs.hash(gid));
+        hash = content_hash(
+            reinterpret_cast<char const*>(glyphs.data()),
+            glyphs.size() * sizeof(uint64_t), hash);
+    }
+    return hash;
+}
+
 bool CFFTable::Font::operator==(Font const& rhs) const noexcept
 {
     return name == rhs.name && fontinfo == rhs.fontinfo
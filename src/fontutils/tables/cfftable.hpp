@@ -1,7 +1,7 @@
 #ifndef TABLES_CFF_TABLE_HPP
 #define TABLES_CFF_TABLE_HPP
 
-#include "../glyph.hpp"
+#include "cffglyphs.hpp"
 #include "otftable.hpp"
 
 #include <array>
@@ -62,8 +62,8 @@ public:
         // charset (gid -> cid mappings)
         std::vector<uint16_t> charset;
 
-        // charstrings (indexed by gid)
-        std::vector<Glyph> glyphs;
+        // charstrings (indexed by gid), decoded on demand
+        CFFGlyphs glyphs;
 
         // font dict index
         std::vector<uint8_t> fd_select;
@@ -97,13 +97,36 @@ public:
     };
     std::vector<Font> fonts;
 
+    /// Move charstring code repeated across glyphs to subroutines on
+    /// compile. Only a table with a single font is subroutinized, and only
+    /// when all of its glyphs are encoded again. Otherwise the charstrings
+    /// that are kept are written along with the subroutines they were
+    /// read with.
+    bool subroutinize = true;
+
+    /// Copy the charstrings of glyphs that are not dirty as they were
+    /// read, so that their hints and subroutine calls are kept. Otherwise
+    /// every glyph is encoded from its paths.
+    bool keep_charstrings = true;
+
+    /// Threads to encode and subroutinize charstrings on
+    unsigned num_threads = 1;
+
 public:
     CFFTable();
-    virtual void parse(InputBuffer& dis) override;
+    virtual void parse(BufferView& dis) override;
     virtual void compile(OutputBuffer& out) const override;
     virtual bool operator==(OTFTable const& rhs) const noexcept override;
 
+    /// Also forgets the hashes of all glyphs
+    virtual void invalidate_hash() noexcept override;
+
     static constexpr char const* tag = "CFF ";
+
+protected:
+    /// Hash of the glyphs, charsets and font names.
+    /// Font and private dicts are left to operator==.
+    virtual uint64_t calculate_hash() const override;
 };
 }
 
@@ -12,27 +12,36 @@ CmapFormat12Subtable::CmapFormat12Subtable(
     : CmapSubtable(platform_id, encoding_id)
 {}
 
-void CmapFormat12Subtable::parse(InputBuffer& dis)
+void CmapFormat12Subtable::parse(BufferView& dis)
 {
     auto format = dis.read<uint16_t>();
     if (format != 12)
-        throw std::runtime_error("Format is not 12");
+        return dis.fail(ParseError::Code::unsupported, "Format is not 12");
 
     // reserved
     if (dis.read<uint16_t>() != 0)
-        throw std::runtime_error("Reserved field not 0");
+        return dis.fail(ParseError::Code::bad_value, "Reserved field not 0");
 
     // length
     dis.read<uint32_t>();
     // language
     language = dis.read<uint32_t>();
 
+    // startCharCode, endCharCode and startGlyphID for each group
     auto num_groups = dis.read<uint32_t>();
+    if (num_groups > (dis.size() - dis.tell()) / 12)
+        return dis.fail(
+            ParseError::Code::bad_value, "Too many sequential map groups");
+    std::vector<uint32_t> groups(std::size_t(num_groups) * 3);
+    dis.read<uint32_t>(groups.data(), groups.size());
     for (auto i = 0u; i < num_groups; ++i)
     {
-        char32_t start_char_code = dis.read<uint32_t>();
-        char32_t end_char_code = dis.read<uint32_t>();
-        uint32_t start_glyph_id = dis.read<uint32_t>();
+        char32_t start_char_code = groups[i * 3];
+        char32_t end_char_code = groups[i * 3 + 1];
+        uint32_t start_glyph_id = groups[i * 3 + 2];
+        if (start_char_code > end_char_code || end_char_code > 0x10FFFF)
+            return dis.fail(
+                ParseError::Code::bad_value, "Invalid sequential map group");
 
         for (auto c = start_char_code; c <= end_char_code; ++c)
         {
@@ -86,12 +95,15 @@ void CmapFormat12Subtable::compile(OutputBuffer& out) const
     out.write<uint32_t>(language);
     out.write<uint32_t>(group_list.size());
 
+    std::vector<uint32_t> groups;
+    groups.reserve(group_list.size() * 3);
     for (auto const& group : group_list)
     {
-        out.write<uint32_t>(group.start_char_code);
-        out.write<uint32_t>(group.end_char_code);
-        out.write<uint32_t>(group.start_glyph_id);
+        groups.push_back(group.start_char_code);
+        groups.push_back(group.end_char_code);
+        groups.push_back(group.start_glyph_id);
     }
+    out.write<uint32_t>(groups.data(), groups.size());
 }
 
 bool CmapFormat12Subtable::operator==(OTFTable const& rhs) const noexcept
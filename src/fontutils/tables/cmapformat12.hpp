@@ -18,7 +18,7 @@ public:
 
 public:
     CmapFormat12Subtable(uint16_t platform_id, uint16_t encoding_id);
-    virtual void parse(InputBuffer& dis) override;
+    virtual void parse(BufferView& dis) override;
     virtual void compile(OutputBuffer& out) const override;
     virtual bool operator==(OTFTable const& rhs) const noexcept override;
 };
@@ -11,46 +11,56 @@ CmapFormat14Subtable::CmapFormat14Subtable(
     : CmapSubtable(platform_id, encoding_id)
 {}
 
-void CmapFormat14Subtable::parse(InputBuffer& dis)
+void CmapFormat14Subtable::parse(BufferView& dis)
 {
     auto beginning = dis.tell();
 
     auto format = dis.read<uint16_t>();
     if (format != 14)
-        throw std::runtime_error("Format is not 14");
+        return dis.fail(ParseError::Code::unsupported, "Format is not 14");
 
     // length
     dis.read<uint32_t>();
 
     auto num_uvs_selectors = dis.read<uint32_t>();
+    if (num_uvs_selectors > (dis.size() - dis.tell()) / 11)
+        return dis.fail(
+            ParseError::Code::bad_value, "Too many variation selector records");
     for (auto i = 0u; i < num_uvs_selectors; ++i)
     {
         char32_t var_selector = dis.read_nint(3);
 
         UVS uvs;
 
-        std::streamoff default_uvs_offset = dis.read<uint32_t>();
+        std::size_t default_uvs_offset = dis.read<uint32_t>();
         if (default_uvs_offset > 0)
         {
-            auto lock = dis.seek_lock(beginning + default_uvs_offset);
-            auto num_ranges = dis.read<uint32_t>();
+            auto dflt_dis = dis.at(beginning + default_uvs_offset);
+            auto num_ranges = dflt_dis.read<uint32_t>();
+            if (num_ranges > (dflt_dis.size() - dflt_dis.tell()) / 4)
+                return dflt_dis.fail(
+                    ParseError::Code::bad_value, "Too many default UVS ranges");
             for (auto i = 0u; i < num_ranges; ++i)
             {
-                char32_t start_val = dis.read_nint(3);
-                int      count = dis.read<uint8_t>() + 1;
+                char32_t start_val = dflt_dis.read_nint(3);
+                int      count = dflt_dis.read<uint8_t>() + 1;
                 uvs.dflt.push_back({ start_val, count });
             }
         }
 
-        std::streamoff special_uvs_offset = dis.read<uint32_t>();
+        std::size_t special_uvs_offset = dis.read<uint32_t>();
         if (special_uvs_offset > 0)
         {
-            auto lock = dis.seek_lock(beginning + special_uvs_offset);
-            auto num_uvs_mappings = dis.read<uint32_t>();
+            auto special_dis = dis.at(beginning + special_uvs_offset);
+            auto num_uvs_mappings = special_dis.read<uint32_t>();
+            auto left = special_dis.size() - special_dis.tell();
+            if (num_uvs_mappings > left / 5)
+                return special_dis.fail(
+                    ParseError::Code::bad_value, "Too many UVS mappings");
             for (auto i = 0u; i < num_uvs_mappings; ++i)
             {
-                char32_t unicode_value = dis.read_nint(3);
-                auto     gid = dis.read<uint16_t>();
+                char32_t unicode_value = special_dis.read_nint(3);
+                auto     gid = special_dis.read<uint16_t>();
                 uvs.special.push_back({ unicode_value, gid });
             }
         }
@@ -15,16 +15,18 @@ CmapFormat4Subtable::CmapFormat4Subtable(
     : CmapSubtable(platform_id, encoding_id)
 {}
 
-void CmapFormat4Subtable::parse(InputBuffer& dis)
+void CmapFormat4Subtable::parse(BufferView& dis)
 {
     auto format = dis.read<uint16_t>();
     if (format != 4)
-        throw std::runtime_error("Format is not 4");
+        return dis.fail(ParseError::Code::unsupported, "Format is not 4");
 
     auto length = dis.read<uint16_t>();
     language = dis.read<uint16_t>();
 
     int seg_count = dis.read<uint16_t>() / 2;
+    if (seg_count == 0 || length < 16 + 8 * seg_count)
+        return dis.fail(ParseError::Code::bad_value, "Invalid segment count");
 
     // searchRange
     dis.read<uint16_t>();
@@ -37,17 +39,20 @@ void CmapFormat4Subtable::parse(InputBuffer& dis)
     std::vector<uint16_t> end_code(seg_count);
     dis.read<uint16_t>(end_code.data(), seg_count);
     if (end_code[seg_count - 1] != 0xFFFF)
-        throw std::runtime_error("Last end code is not 0xFFFF");
+        return dis.fail(
+            ParseError::Code::bad_value, "Last end code is not 0xFFFF");
 
     // reservedPad (Should be zero)
     if (dis.read<uint16_t>() != 0)
-        throw std::runtime_error("Reserved pad is not zero");
+        return dis.fail(
+            ParseError::Code::bad_value, "Reserved pad is not zero");
 
     // Starting character code for each segment
     std::vector<uint16_t> start_code(seg_count);
     dis.read<uint16_t>(start_code.data(), seg_count);
     if (start_code[seg_count - 1] != 0xFFFF)
-        throw std::runtime_error("Last start code is not 0xFFFF");
+        return dis.fail(
+            ParseError::Code::bad_value, "Last start code is not 0xFFFF");
 
     // Used when idRangeOffset == 0
     std::vector<uint16_t> id_delta(seg_count);
@@ -55,12 +60,7 @@ void CmapFormat4Subtable::parse(InputBuffer& dis)
 
     // idRangeOffset
     std::vector<uint16_t> id_range_offset(seg_count);
-    std::vector<std::size_t>   range_offset_start(seg_count);
-    for (int i = 0; i < seg_count; ++i)
-    {
-        range_offset_start[i] = dis.tell();
-        id_range_offset[i] = dis.read<uint16_t>();
-    }
+    dis.read<uint16_t>(id_range_offset.data(), seg_count);
 
     // glyphIdArray
     std::size_t                gid_len = (length - 16 - 8 * seg_count) / 2;
@@ -85,7 +85,9 @@ void CmapFormat4Subtable::parse(InputBuffer& dis)
             {
                 std::size_t id = (i - seg_count) + id_range_offset[i] / 2 + j;
                 if (id >= gid_len)
-                    throw std::runtime_error("id out of glyph id array bounds");
+                    return dis.fail(
+                        ParseError::Code::bad_value,
+                        "id out of glyph id array bounds");
 
                 if (id == 0)
                 {
@@ -199,20 +201,22 @@ void CmapFormat4Subtable::compile(OutputBuffer& out) const
     // rangeShift
     out.write<uint16_t>(2 * seg_list.size() - search_range);
 
-    for (auto const& seg : seg_list)
-        out.write<uint16_t>(seg.end_code);
+    // gather each field into an array to write them in bulk
+    std::vector<uint16_t> field(seg_list.size());
+    auto write_field = [&](uint16_t Segment::*member) {
+        for (auto i = 0u; i < seg_list.size(); ++i)
+            field[i] = seg_list[i].*member;
+        out.write<uint16_t>(field.data(), field.size());
+    };
+
+    write_field(&Segment::end_code);
 
     // reservedPad
     out.write<uint16_t>(0);
 
-    for (auto const& seg : seg_list)
-        out.write<uint16_t>(seg.start_code);
-
-    for (auto const& seg : seg_list)
-        out.write<uint16_t>(seg.id_delta);
-
-    for (auto const& seg : seg_list)
-        out.write<uint16_t>(seg.id_range_offset);
+    write_field(&Segment::start_code);
+    write_field(&Segment::id_delta);
+    write_field(&Segment::id_range_offset);
 
     out.write<uint16_t>(gid_array.data(), gid_array.size());
 }
@@ -18,13 +18,13 @@ namespace
 {
 /// Factory function to make cmap subtables
 std::unique_ptr<CmapSubtable> make_subtable(
-    InputBuffer&   dis,
-    std::streampos pos,
-    uint16_t       platform_id,
-    uint16_t       encoding_id)
+    BufferView const& dis,
+    std::size_t       pos,
+    uint16_t          platform_id,
+    uint16_t          encoding_id)
 {
-    auto lock = dis.seek_lock(pos);
-    auto format = dis.peek<uint16_t>();
+    auto sub_dis = dis.at(pos);
+    auto format = sub_dis.peek<uint16_t>();
 
     std::unique_ptr<CmapSubtable> table;
     if (format == 4)
@@ -49,19 +49,20 @@ std::unique_ptr<CmapSubtable> make_subtable(
     }
 
     // parse subtable
-    table->parse(dis);
+    table->parse(sub_dis);
 
     return table;
 }
 }
 
-void CmapTable::parse(InputBuffer& dis)
+void CmapTable::parse(BufferView& dis)
 {
     auto beginning = dis.tell();
 
     auto version = dis.read<uint16_t>();
     if (version != 0)
-        throw std::runtime_error("Unrecognized CMap version");
+        return dis.fail(
+            ParseError::Code::unsupported, "Unrecognized CMap version");
 
     auto num_tables = dis.read<uint16_t>();
 
@@ -108,11 +109,7 @@ void CmapTable::compile(OutputBuffer& out) const
     for (auto const& sub : subtables)
     {
         // write offset
-        {
-            auto offset = out.tell() - beginning;
-            auto lock = out.seek_lock(offsets[idx]);
-            out.write<uint32_t>(offset);
-        }
+        out.write_at<uint32_t>(offsets[idx], out.tell() - beginning);
 
         // write table
         sub->compile(out);
@@ -14,7 +14,7 @@ class CmapTable : public OTFTable
 {
 public:
     CmapTable();
-    virtual void parse(InputBuffer& dis) override;
+    virtual void parse(BufferView& dis) override;
     virtual void compile(OutputBuffer& out) const override;
     virtual bool operator==(OTFTable const& rhs) const noexcept override;
 
@@ -1,5 +1,8 @@
 #include "font.hpp"
 
+#include "../checksum.hpp"
+#include "../parallel.hpp"
+
 #include "basetable.hpp"
 #include "cfftable.hpp"
 #include "cmaptable.hpp"
@@ -17,8 +20,13 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
-#include <map>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <set>
 #include <sstream>
+#include <thread>
 #include <typeinfo>
 
 namespace geul
@@ -30,48 +38,99 @@ Font::Font()
 
 namespace
 {
+/// Table types parsed into structures of their own, made by the tag
+/// they declare. Other tables are kept as GenericTable.
+template <typename... Tables> struct TableRegistry
+{
+    template <typename T> static std::unique_ptr<OTFTable> create()
+    {
+        return std::make_unique<T>();
+    }
+
+    /// New table of the type registered for `tag`, or null
+    static std::unique_ptr<OTFTable> make(uint32_t tag)
+    {
+        struct Kind
+        {
+            uint32_t tag;
+            std::unique_ptr<OTFTable> (*create)();
+        };
+        static constexpr Kind kinds[] = {
+            { pack_tag(Tables::tag), &create<Tables> }...
+        };
+
+        for (auto const& kind : kinds)
+            if (kind.tag == tag)
+                return kind.create();
+        return nullptr;
+    }
+};
+
+// 'hmtx' and 'vmtx' are made by Font::parse_table with their metrics
+using Registry = TableRegistry<
+    BaseTable,
+    CFFTable,
+    CmapTable,
+    HeadTable,
+    HheaTable,
+    MaxpTable,
+    NameTable,
+    OS2Table,
+    PostTable,
+    VheaTable>;
+
 // Factory method for making tables
-std::unique_ptr<OTFTable> make_table(
-    std::string name, InputBuffer& dis, std::size_t offset, std::size_t length)
+std::unique_ptr<OTFTable> make_table(uint32_t tag, std::size_t length)
 {
-    std::unique_ptr<OTFTable> table;
-    if (name == "cmap")
-        table = std::make_unique<CmapTable>();
-    else if (name == "name")
-        table = std::make_unique<NameTable>();
-    else if (name == "OS/2")
-        table = std::make_unique<OS2Table>();
-    else if (name == "post")
-        table = std::make_unique<PostTable>();
-    else if (name == "CFF ")
-        table = std::make_unique<CFFTable>();
-    else if (name == "head")
-        table = std::make_unique<HeadTable>();
-    else if (name == "maxp")
-        table = std::make_unique<MaxpTable>();
-    else if (name == "hhea")
-        table = std::make_unique<HheaTable>();
-    else if (name == "BASE")
-        table = std::make_unique<BaseTable>();
-    else if (name == "vhea")
-        table = std::make_unique<VheaTable>();
-    else
-        table = std::make_unique<GenericTable>(name, length);
+    if (auto table = Registry::make(tag))
+        return table;
+    return std::make_unique<GenericTable>(unpack_tag(tag), length);
+}
 
-    auto lock = dis.seek_lock(offset);
-    table->parse(dis);
+constexpr auto head_tag = pack_tag(HeadTable::tag);
+constexpr auto hmtx_tag = pack_tag(HmtxTable::tag);
+constexpr auto vmtx_tag = pack_tag(VmtxTable::tag);
 
-    return table;
+/// Whether the table depends on other tables to be parsed
+bool is_metrics(uint32_t tag)
+{
+    return tag == hmtx_tag || tag == vmtx_tag;
+}
+
+/// Tables that must be parsed before the table `tag`
+std::vector<uint32_t> dependencies(uint32_t tag)
+{
+    if (tag == hmtx_tag)
+        return { pack_tag(MaxpTable::tag), pack_tag(HheaTable::tag) };
+    if (tag == vmtx_tag)
+        return { pack_tag(MaxpTable::tag), pack_tag(VheaTable::tag) };
+    return {};
+}
+
+/// Attribute a recorded error to the table `tag`
+void blame(BufferView const& dis, uint32_t tag)
+{
+    auto error = dis.reported_to();
+    if (error && error->tag.empty())
+        error->tag = unpack_tag(tag);
 }
 }
 
-void Font::parse(InputBuffer& dis)
+void Font::parse(BufferView& dis)
 {
+    parse(dis, ParseOptions());
+}
+
+void Font::parse(BufferView& dis, ParseOptions const& options)
+{
+    tables.clear();
+    complete = true;
+
     auto beginning = dis.tell();
 
     auto sfnt_version = dis.read<uint32_t>();
     if (sfnt_version != 0x4F54544F)
-        throw std::runtime_error("Not a CFF font");
+        return dis.fail(ParseError::Code::unsupported, "Not a CFF font");
     auto num_tables = dis.read<uint16_t>();
 
     // searchRange
@@ -81,195 +140,594 @@ void Font::parse(InputBuffer& dis)
     // rangeShift
     dis.read<uint16_t>();
 
-    struct TableInfo
-    {
-        std::size_t offset;
-        std::size_t length;
+    // Tables listed in the options, and the tables they depend on
+    auto wanted = [&](uint32_t tag) {
+        if (options.tables.empty())
+            return true;
+        for (auto const& listed : options.tables)
+        {
+            auto deps = dependencies(pack_tag(listed));
+            if (pack_tag(listed) == tag
+                || std::find(deps.begin(), deps.end(), tag) != deps.end())
+                return true;
+        }
+        return false;
     };
-    std::map<std::string, TableInfo> tables_pos;
-    uint32_t                         entire_checksum = 0;
-    uint32_t                         checksum_adjustment = 0;
+
     for (auto i = 0u; i < num_tables; ++i)
     {
-        Tag tag;
-        dis.read<uint8_t>(tag.data(), 4);
-        std::string table_name = std::string(tag.begin(), tag.end());
+        auto record = dis.tell();
 
+        uint32_t tag = dis.read<uint32_t>();
         uint32_t checksum = dis.read<uint32_t>();
 
         std::size_t offset = dis.read<uint32_t>();
         std::size_t length = dis.read<uint32_t>();
-        tables_pos[table_name] = { offset, length };
 
-        auto lock = dis.seek_lock(offset);
+        // Keep the bytes, to be parsed on first access. Tables left out
+        // are only written back.
+        auto& entry = insert(tag);
+        entry.offset = offset;
+        entry.record = record - beginning;
+        entry.checksum = checksum;
+        entry.raw = dis.slice(offset, length).read_shared(length);
+        entry.left_out = !wanted(tag);
+        if (entry.left_out)
+            complete = false;
+
+        // Table out of bounds
+        if (dis.failed())
+            return blame(dis, tag);
+    }
+
+    auto directory_dis = dis.slice(beginning, dis.tell() - beginning);
+    directory = directory_dis.read_shared(directory_dis.size());
+    if (dis.failed())
+        return;
+
+    if (options.checksums == ParseOptions::Checksums::verify)
+    {
+        directory_dis.seek(0);
+        check_checksums(directory_dis);
+        if (dis.failed())
+            return;
+    }
 
-        uint32_t calc_checksum = calculate_checksum(dis, length);
+    const char* required_tables[] = {
+        "cmap", "head", "hhea", "hmtx",
+        "maxp", "name", "OS/2", "post", // required for sfnt
+        "CFF ", "VORG", // required for CFF outlines
+    };
+
+    for (auto r : required_tables)
+    {
+        auto tag = pack_tag(r);
+        if (options.require_tables && wanted(tag) && !find(tag))
+        {
+            std::ostringstream oss;
+            oss << "Font does not have the required table '" << r << "'.";
+            dis.fail(ParseError::Code::missing_table, oss.str());
+            return blame(dis, tag);
+        }
+    }
+    for (auto const& entry : tables)
+    {
+        if (entry.left_out)
+            continue;
+        for (auto dep : dependencies(entry.tag))
+        {
+            if (!find(dep))
+            {
+                std::ostringstream oss;
+                oss << "Font does not have the table '" << unpack_tag(dep)
+                    << "' required by '" << unpack_tag(entry.tag) << "'.";
+                dis.fail(ParseError::Code::missing_table, oss.str());
+                return blame(dis, dep);
+            }
+        }
+    }
+}
+
+void Font::check_checksums(BufferView& dis) const
+{
+    // In the order of the table records
+    std::vector<std::pair<std::size_t, Entry const*>> records;
+    for (auto const& entry : tables)
+        if (!entry.left_out)
+            records.emplace_back(entry.record, &entry);
+    std::sort(records.begin(), records.end());
+
+    uint32_t entire_checksum = calculate_checksum(dis.at(0), dis.size());
+    uint32_t checksum_adjustment = 0;
+    for (auto const& record : records)
+    {
+        Entry const& entry = *record.second;
+
+        auto     data = entry.raw.data.get();
+        uint32_t calc_checksum = checksum(data, entry.raw.size);
 
         // Exclude checkSumAdjustment value for the 'head' table
-        if (table_name == "head")
+        if (entry.tag == head_tag && entry.raw.size >= 12)
         {
-            dis.seek(offset + 8);
-            checksum_adjustment = dis.read<uint32_t>();
+            checksum_adjustment = to_machine_endian<uint32_t>(data + 8);
             calc_checksum -= checksum_adjustment;
         }
 
         entire_checksum += calc_checksum;
 
         // Verify checksum
-        if (checksum != calc_checksum)
+        if (entry.checksum != calc_checksum)
         {
             std::ostringstream oss;
-            oss << "Invalid checksum " << std::hex << checksum;
-            oss << " for table '" << table_name << "'.\n";
+            oss << "Invalid checksum " << std::hex << entry.checksum;
+            oss << " for table '" << unpack_tag(entry.tag) << "'.\n";
             oss << "Calculated : " << calc_checksum;
-            throw std::runtime_error(oss.str());
+            dis.seek(record.first);
+            dis.fail(ParseError::Code::bad_checksum, oss.str());
+            return blame(dis, entry.tag);
         }
     }
 
-    const char* required_tables[] = {
-        "cmap", "head", "hhea", "hmtx",
-        "maxp", "name", "OS/2", "post", // required for sfnt
-        "CFF ", "VORG", // required for CFF outlines
+    // Validate checksumAdjustment, when no table was left out
+    if (complete && entire_checksum + checksum_adjustment != 0xB1B0AFBA)
+    {
+        dis.seek(dis.size());
+        return dis.fail(
+            ParseError::Code::bad_checksum, "Invalid font checksum.");
+    }
+}
+
+ParseError Font::verify_checksums() const
+{
+    ParseError error;
+    auto       dis = BufferView(directory.span()).report_to(&error);
+    check_checksums(dis);
+    return error;
+}
+
+void Font::parse_tables(BufferView const& dis, unsigned num_threads)
+{
+    struct Task
+    {
+        Entry const*             entry;
+        std::size_t              waiting = 0; // dependencies not parsed yet
+        std::vector<std::size_t> dependents;
+        bool                     skipped = false;
+        ParseError               error;
+        std::exception_ptr       exception;
     };
 
-    for (auto r : required_tables)
+    // Tables to parse, in the order they are parsed by a single thread.
+    // 'hmtx' and 'vmtx' go last, after the tables they depend on.
+    std::vector<Task> tasks;
+    for (bool metrics : { false, true })
     {
-        if (tables_pos.count(r) == 0)
+        for (auto const& entry : tables)
         {
-            std::ostringstream oss;
-            oss << "Font does not have the required table '" << r << "'.";
-            throw std::runtime_error(oss.str());
+            if (!entry.table && !entry.left_out
+                && is_metrics(entry.tag) == metrics)
+            {
+                tasks.emplace_back();
+                tasks.back().entry = &entry;
+            }
         }
     }
 
-    // Validate checksumAdjustment
-    auto length = dis.seek(beginning) - beginning;
-    entire_checksum += calculate_checksum(dis, length);
-    if (entire_checksum + checksum_adjustment != 0xB1B0AFBA)
+    // Dependency graph
+    for (auto i = 0u; i < tasks.size(); ++i)
     {
-        throw std::runtime_error("Invalid font checksum.");
+        for (auto dep : dependencies(tasks[i].entry->tag))
+        {
+            auto it = std::find_if(
+                tasks.begin(), tasks.end(),
+                [&](Task const& task) { return task.entry->tag == dep; });
+            if (it == tasks.end())
+                continue;
+            ++tasks[i].waiting;
+            it->dependents.push_back(i);
+        }
     }
 
-    // Parse the tables
-    for (auto const& table : tables_pos)
-    {
-        std::string const& tag = table.first;
-        TableInfo const&   info = table.second;
+    std::mutex              mutex;
+    std::condition_variable cv;
+    std::set<std::size_t>   ready; // lowest index first
+    std::size_t             remaining = tasks.size();
+    for (auto i = 0u; i < tasks.size(); ++i)
+        if (tasks[i].waiting == 0)
+            ready.insert(i);
+
+    // Tables that depend on a table that failed are never parsed
+    std::function<void(std::size_t)> skip = [&](std::size_t i) {
+        for (auto d : tasks[i].dependents)
+        {
+            if (!tasks[d].skipped)
+            {
+                tasks[d].skipped = true;
+                --remaining;
+                skip(d);
+            }
+        }
+    };
+
+    auto work = [&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            cv.wait(lock, [&] { return !ready.empty() || remaining == 0; });
+            if (remaining == 0)
+                return;
+
+            auto i = *ready.begin();
+            ready.erase(ready.begin());
+            Task& task = tasks[i];
+            lock.unlock();
+
+            try
+            {
+                Entry const& entry = *task.entry;
+                auto         table_dis = dis.slice(entry.offset, entry.raw.size)
+                                   .report_to(&task.error);
+                parse_table(entry, table_dis);
+            }
+            catch (...)
+            {
+                task.exception = std::current_exception();
+            }
+
+            lock.lock();
+            --remaining;
+            if (task.error || task.exception)
+                skip(i);
+            else
+            {
+                for (auto d : task.dependents)
+                    if (--tasks[d].waiting == 0 && !tasks[d].skipped)
+                        ready.insert(d);
+            }
+            cv.notify_all();
+        }
+    };
 
-        if (tag == "hmtx" || tag == "vmtx")
+    std::vector<std::thread> workers;
+    for (auto n = 1u; n < num_threads && n < tasks.size(); ++n)
+        workers.emplace_back(work);
+    work();
+    for (auto& worker : workers)
+        worker.join();
+
+    // Report the error that parsing one by one would have stopped at
+    for (auto& task : tasks)
+    {
+        if (task.exception)
+            std::rethrow_exception(task.exception);
+        if (!task.error)
             continue;
 
-        tables[tag] = make_table(tag, dis, info.offset, info.length);
+        auto error = dis.reported_to();
+        if (!error)
+            throw std::runtime_error(task.error.message);
+        if (!*error)
+            *error = std::move(task.error);
+        return blame(dis, task.entry->tag);
     }
+}
 
-    // Parse remaining tables : 'hmtx' and 'vmtx'
-    auto const num_glyphs
-        = dynamic_cast<MaxpTable&>(*tables["maxp"]).num_glyphs;
+void Font::parse_table(Entry const& entry, BufferView& dis) const
+{
+    std::unique_ptr<OTFTable> table;
+    if (is_metrics(entry.tag))
     {
-        auto lock = dis.seek_lock(tables_pos["hmtx"].offset);
-        auto hmtx = std::make_unique<HmtxTable>(
-            num_glyphs,
-            dynamic_cast<HheaTable&>(*tables["hhea"]).num_h_metrics);
-        hmtx->parse(dis);
-        tables["hmtx"] = std::move(hmtx);
+        bool const horizontal = entry.tag == hmtx_tag;
+
+        std::size_t const num_glyphs = this->table<MaxpTable>()->num_glyphs;
+        std::size_t const num_metrics = horizontal
+            ? this->table<HheaTable>()->num_h_metrics
+            : this->table<VheaTable>()->num_long_ver_metrics;
+        if (num_metrics > num_glyphs)
+        {
+            return dis.fail(
+                ParseError::Code::bad_value,
+                horizontal ? "More horizontal metrics than glyphs"
+                           : "More vertical metrics than glyphs");
+        }
+
+        if (horizontal)
+            table = std::make_unique<HmtxTable>(num_glyphs, num_metrics);
+        else
+            table = std::make_unique<VmtxTable>(num_glyphs, num_metrics);
     }
+    else
+        table = make_table(entry.tag, dis.size());
 
-    if (tables_pos.count("vmtx"))
+    table->parse(dis);
+    if (!dis.failed())
+        entry.table = std::move(table);
+}
+
+Font::Entry const* Font::find(uint32_t tag) const
+{
+    auto it = std::lower_bound(
+        tables.begin(), tables.end(), tag,
+        [](Entry const& entry, uint32_t tag) { return entry.tag < tag; });
+    if (it == tables.end() || it->tag != tag)
+        return nullptr;
+    return &*it;
+}
+
+Font::Entry& Font::insert(uint32_t tag)
+{
+    auto it = std::lower_bound(
+        tables.begin(), tables.end(), tag,
+        [](Entry const& entry, uint32_t tag) { return entry.tag < tag; });
+    if (it == tables.end() || it->tag != tag)
     {
-        auto lock = dis.seek_lock(tables_pos["vmtx"].offset);
-        auto vmtx = std::make_unique<VmtxTable>(
-            num_glyphs,
-            dynamic_cast<VheaTable&>(*tables["vhea"]).num_long_ver_metrics);
-        vmtx->parse(dis);
-        tables["vmtx"] = std::move(vmtx);
+        it = tables.emplace(it);
+        it->tag = tag;
     }
+    return *it;
 }
 
-void Font::compile(OutputBuffer& out) const
+OTFTable const* Font::load(uint32_t tag) const
 {
-    auto beginning = out.tell();
+    auto entry = find(tag);
+    if (!entry || entry->left_out)
+        return nullptr;
+
+    // Readers of a const font may get to the same table at once.
+    // 'hmtx' and 'vmtx' lock the tables they depend on while parsing.
+    std::lock_guard<std::mutex> lock(*entry->parsing);
+    if (!entry->table)
+    {
+        auto const& raw = entry->raw;
+        BufferView  dis(raw.data.get(), raw.size, raw.data, entry->offset);
+        parse_table(*entry, dis);
+    }
+    return entry->table.get();
+}
+
+OTFTable* Font::modify(uint32_t tag)
+{
+    auto table = const_cast<OTFTable*>(load(tag));
+    if (table)
+    {
+        const_cast<Entry*>(find(tag))->dirty = true;
+        table->invalidate_hash();
+        OTFTable::invalidate_hash();
+    }
+    return table;
+}
+
+OTFTable* Font::table(std::string const& tag)
+{
+    return modify(pack_tag(tag));
+}
+
+OTFTable const* Font::table(std::string const& tag) const
+{
+    return load(pack_tag(tag));
+}
+
+bool Font::parsed(std::string const& tag) const
+{
+    auto entry = find(pack_tag(tag));
+    if (!entry)
+        return false;
+    std::lock_guard<std::mutex> lock(*entry->parsing);
+    return entry->table != nullptr;
+}
+
+bool Font::modified(std::string const& tag) const
+{
+    auto entry = find(pack_tag(tag));
+    return entry && entry->dirty;
+}
+
+std::vector<std::string> Font::tags() const
+{
+    std::vector<std::string> tags;
+    for (auto const& entry : tables)
+        tags.push_back(unpack_tag(entry.tag));
+    return tags;
+}
+
+std::size_t Font::directory_size(std::size_t num_tables)
+{
+    return 12 + 16 * num_tables;
+}
 
+void Font::write_directory(
+    OutputBuffer& out, std::vector<Record> const& records)
+{
     // snft version
     out.write<uint32_t>(0x4F54544F);
 
     // numTables
-    out.write<uint16_t>(tables.size());
+    out.write<uint16_t>(records.size());
 
     // searchRange
-    auto search_range = 16 * le_pow2(tables.size());
+    auto search_range = 16 * le_pow2(records.size());
     out.write<uint16_t>(search_range);
     // entrySelector
-    out.write<uint16_t>(std::ilogb(tables.size()));
+    out.write<uint16_t>(std::ilogb(records.size()));
     // rangeShift
-    out.write<uint16_t>(tables.size() * 16 - search_range);
-
-    std::vector<std::streampos> checksums;
+    out.write<uint16_t>(records.size() * 16 - search_range);
 
     // Table Records
-    for (auto const& pp : tables)
+    for (auto const& record : records)
     {
-        std::string table_name = pp.first;
-
-        // table name
-        out.write<char>(table_name.data(), 4);
-
-        // placeholder for checksum
-        checksums.push_back(out.tell());
-        out.write<uint32_t>(0);
+        out.write<uint32_t>(record.tag);
+        out.write<uint32_t>(record.checksum);
+        out.write<uint32_t>(record.offset);
+        out.write<uint32_t>(record.length);
+    }
+}
 
-        // placeholder for offset
-        out.write<uint32_t>(0);
+uint32_t Font::compile_entry(OutputBuffer& out, Entry const& entry)
+{
+    auto beginning = out.tell();
+    out.begin_checksum();
+    if (auto table = entry.compiled())
+        table->compile(out);
+    else
+    {
+        out.write<char>(entry.raw.data.get(), entry.raw.size);
 
-        // placeholder for length
-        out.write<uint32_t>(0);
+        // checkSumAdjustment is summed as zero
+        if (entry.tag == head_tag && entry.raw.size >= 12)
+            out.write_at<uint32_t>(beginning + 8, 0);
     }
     out.pad();
-    auto offset_table_size = out.tell() - beginning;
+    return out.end_checksum();
+}
+
+void Font::compile(OutputBuffer& out) const
+{
+    if (!find(head_tag))
+        throw std::runtime_error("'head' table not present");
+
+    auto beginning = out.tell();
+
+    // placeholder for the offset table
+    out.write_zeros(directory_size(tables.size()));
 
     // Table data
-    uint32_t entire_checksum = 0;
-    int      checksum_adj_pos = -1;
-    int      idx = 0;
-    for (auto const& pp : tables)
+    std::vector<Record> records;
+    uint32_t                 entire_checksum = 0;
+    std::size_t              checksum_adj_pos = 0;
+    for (auto const& entry : tables)
     {
-        std::string table_name = pp.first;
-        auto const& table = pp.second;
-
-        auto table_begin = out.tell();
+        Record record;
+        record.tag = entry.tag;
+        record.offset = out.tell() - beginning;
 
         // Store position of checksumAdjustment
-        if (table_name == "head")
-            checksum_adj_pos = table_begin + std::streamoff(8);
+        if (entry.tag == head_tag)
+            checksum_adj_pos = out.tell() + 8;
+
+        record.checksum = compile_entry(out, entry);
+        record.length = out.tell() - beginning - record.offset;
+        entire_checksum += record.checksum;
+        records.push_back(record);
+        out.seek_end();
+    }
 
-        table->compile(out);
-        out.pad();
+    // Fill in the offset table
+    out.seek(beginning);
+    write_directory(out, records);
+    entire_checksum
+        += calculate_checksum(out.view().at(beginning), out.tell() - beginning);
+    out.seek_end();
 
-        auto length = out.seek(table_begin) - table_begin;
-        auto checksum = calculate_checksum(out, length);
-        entire_checksum += checksum;
+    // set checksumAdjustment value
+    uint32_t checksum_adj = uint32_t(0xB1B0AFBA) - entire_checksum;
+    out.write_at<uint32_t>(checksum_adj_pos, checksum_adj);
+}
 
-        // write checksum, offset, and length value
-        {
-            auto lock = out.seek_lock(checksums[idx]);
-            out.write<uint32_t>(checksum);
-            out.write<uint32_t>(table_begin - beginning);
-            out.write<uint32_t>(length);
-        }
+void Font::compile(OutputBuffer& out, unsigned num_threads) const
+{
+    if (num_threads <= 1)
+        return compile(out);
 
-        idx++;
+    if (!find(head_tag))
+        throw std::runtime_error("'head' table not present");
+
+    // Table data and checksums
+    std::vector<OutputBuffer> buffers(tables.size());
+    std::vector<Record>  records(tables.size());
+    parallel_for(tables.size(), num_threads, [&](std::size_t i) {
+        auto const& entry = tables[i];
+
+        records[i].tag = entry.tag;
+        records[i].checksum = compile_entry(buffers[i], entry);
+        records[i].length = buffers[i].tell();
+    });
+
+    // Layout
+    std::size_t offset = directory_size(tables.size());
+    uint32_t    entire_checksum = 0;
+    for (auto i = 0u; i < tables.size(); ++i)
+    {
+        records[i].offset = offset;
+        offset += buffers[i].size();
+        entire_checksum += records[i].checksum;
     }
-    out.pad();
 
-    if (checksum_adj_pos == -1)
-        throw std::runtime_error("'head' table not present");
+    auto beginning = out.tell();
+    out.reserve(beginning + offset);
+    write_directory(out, records);
+    entire_checksum
+        += calculate_checksum(out.view().at(beginning), out.tell() - beginning);
+
+    std::size_t checksum_adj_pos = 0;
+    for (auto i = 0u; i < tables.size(); ++i)
+    {
+        // Store position of checksumAdjustment
+        if (records[i].tag == head_tag)
+            checksum_adj_pos = out.tell() + 8;
+
+        auto span = buffers[i].view().span();
+        out.write<char>(span.data, span.size);
+        buffers[i] = OutputBuffer();
+    }
 
     // set checksumAdjustment value
+    uint32_t checksum_adj = uint32_t(0xB1B0AFBA) - entire_checksum;
+    out.write_at<uint32_t>(checksum_adj_pos, checksum_adj);
+}
+
+void Font::compile(std::ostream& os) const
+{
+    if (!find(head_tag))
+        throw std::runtime_error("'head' table not present");
+
+    // First pass: sizes and checksums. Compiled tables are kept to be
+    // written as they are, and unmodified ones are copied from their bytes
+    // one at a time.
+    OutputBuffer              table_buf;
+    std::vector<OutputBuffer> compiled(tables.size());
+    std::vector<Record>       records(tables.size());
+    std::size_t               offset = directory_size(tables.size());
+    uint32_t                  entire_checksum = 0;
+    for (auto i = 0u; i < tables.size(); ++i)
     {
-        auto lock = out.seek_lock(beginning);
-        entire_checksum += calculate_checksum(out, offset_table_size);
-        out.seek(checksum_adj_pos);
-        uint32_t checksum_adj = uint32_t(0xB1B0AFBA) - entire_checksum;
-        out.write<uint32_t>(checksum_adj);
+        auto const& entry = tables[i];
+        auto&       buf = entry.compiled() ? compiled[i] : table_buf;
+        buf.clear();
+
+        auto& record = records[i];
+        record.tag = entry.tag;
+        record.checksum = compile_entry(buf, entry);
+        record.offset = offset;
+        record.length = buf.tell();
+        offset += buf.size();
+        entire_checksum += record.checksum;
+    }
+
+    OutputBuffer header;
+    write_directory(header, records);
+    entire_checksum += calculate_checksum(header.view(), header.size());
+    header.save(os);
+
+    // Second pass: write the tables in order
+    for (auto i = 0u; i < tables.size(); ++i)
+    {
+        auto const& entry = tables[i];
+        auto&       buf = entry.compiled() ? compiled[i] : table_buf;
+        if (!entry.compiled())
+        {
+            table_buf.clear();
+            if (compile_entry(table_buf, entry) != records[i].checksum
+                || table_buf.tell() != records[i].length)
+                throw std::runtime_error("Table changed between passes");
+        }
+
+        if (entry.tag == head_tag)
+        {
+            uint32_t checksum_adj = uint32_t(0xB1B0AFBA) - entire_checksum;
+            buf.write_at<uint32_t>(8, checksum_adj);
+        }
+        buf.save(os);
+        compiled[i] = OutputBuffer();
     }
 }
 
@@ -281,24 +739,125 @@ bool Font::operator==(OTFTable const& rhs) const noexcept
     if (tables.size() != other.tables.size())
         return false;
 
-    for (auto const& table : tables)
+    try
     {
-        // no table with matching tag
-        if (other.tables.count(table.first) == 0)
-            return false;
-
-        auto const& t0 = *table.second;
-        auto const& t1 = *other.tables.at(table.first);
-        if (!(t0 == t1))
-            return false;
+        // Both are sorted by tag
+        for (auto i = 0u; i < tables.size(); ++i)
+        {
+            // no table with matching tag
+            Entry const& e0 = tables[i];
+            Entry const& e1 = other.tables[i];
+            if (e0.tag != e1.tag)
+                return false;
+
+            if (!same_table(e0, other, e1))
+                return false;
+        }
+    }
+    catch (std::exception const&)
+    {
+        // a table that cannot be parsed
+        return false;
     }
     return true;
 }
 
+bool Font::same_table(Entry const& entry, Font const& other, Entry const& rhs)
+    const
+{
+    // Unmodified tables are equal when their bytes are, and tables left
+    // out are only known by their bytes
+    if (!entry.dirty && !rhs.dirty && entry.raw == rhs.raw)
+        return true;
+    if (entry.left_out || rhs.left_out)
+        return false;
+
+    auto const& t0 = *load(entry.tag);
+    auto const& t1 = *other.load(rhs.tag);
+    return t0.hash() == t1.hash() && t0 == t1;
+}
+
+FontDiff Font::diff(Font const& other) const
+{
+    FontDiff diff;
+
+    // Both are sorted by tag
+    auto i = 0u, j = 0u;
+    while (i < tables.size() || j < other.tables.size())
+    {
+        if (j == other.tables.size()
+            || (i < tables.size() && tables[i].tag < other.tables[j].tag))
+        {
+            diff.tables.push_back(unpack_tag(tables[i++].tag));
+            continue;
+        }
+        if (i == tables.size() || other.tables[j].tag < tables[i].tag)
+        {
+            diff.tables.push_back(unpack_tag(other.tables[j++].tag));
+            continue;
+        }
+
+        Entry const& e0 = tables[i++];
+        Entry const& e1 = other.tables[j++];
+        if (same_table(e0, other, e1))
+            continue;
+        diff.tables.push_back(unpack_tag(e0.tag));
+
+        // Hashing the tables hashed their glyphs, which now compare fast
+        if (e0.tag == pack_tag(CFFTable::tag) && !e0.left_out
+            && !e1.left_out)
+        {
+            static CFFGlyphs const none;
+            auto const& cff0 = *table<CFFTable>();
+            auto const& cff1 = *other.table<CFFTable>();
+            auto const& g0 = cff0.fonts.empty() ? none : cff0.fonts[0].glyphs;
+            auto const& g1 = cff1.fonts.empty() ? none : cff1.fonts[0].glyphs;
+            diff.glyphs = g0.differences(g1);
+        }
+    }
+    return diff;
+}
+
+void Font::invalidate_hash() noexcept
+{
+    OTFTable::invalidate_hash();
+    for (auto& entry : tables)
+        if (entry.table)
+            entry.table->invalidate_hash();
+}
+
+uint64_t Font::calculate_hash() const
+{
+    uint64_t hash = tables.size();
+    for (auto const& entry : tables)
+    {
+        auto const& raw = entry.raw;
+        auto        table_hash = entry.left_out
+                                     ? content_hash(raw.data.get(), raw.size)
+                                     : load(entry.tag)->hash();
+        uint64_t const words[] = { entry.tag, table_hash };
+        hash = content_hash(
+            reinterpret_cast<char const*>(words), sizeof(words), hash);
+    }
+    return hash;
+}
+
 Glyph& Font::glyph(char32_t ch)
 {
-    auto& cmap = dynamic_cast<CmapTable&>(*tables["cmap"]);
-    auto& cff = dynamic_cast<CFFTable&>(*tables["CFF "]);
-    return cff.fonts[0].glyphs.at(cmap.gid(ch));
+    // 'cmap' is only read
+    Font const& font = *this;
+    auto        cmap = font.table<CmapTable>();
+    auto        cff = const_cast<CFFTable*>(font.table<CFFTable>());
+    if (!cmap || !cff || cff->fonts.empty())
+        throw std::runtime_error("Font has no 'cmap' or 'CFF ' table");
+    auto& glyph = cff->fonts[0].glyphs.at(cmap->gid(ch));
+
+    // Only the glyph handed out can change, so the other glyphs keep
+    // their hashes
+    const_cast<Entry*>(find(pack_tag(CFFTable::tag)))->dirty = true;
+    cff->OTFTable::invalidate_hash();
+    OTFTable::invalidate_hash();
+    glyph.invalidate_hash();
+    return glyph;
 }
 }
@@ -4,25 +4,192 @@
 #include "otftable.hpp"
 
 #include "../glyph.hpp"
+#include "../parseoptions.hpp"
 
-#include <map>
+#include <iosfwd>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace geul
 {
 
+/// Tables and glyphs that differ between two fonts
+struct FontDiff
+{
+    /// Tags of the tables that differ or are in one of the fonts only
+    std::vector<std::string> tables;
+
+    /// IDs of the glyphs that differ, including those in one font only,
+    /// when the 'CFF ' tables differ
+    std::vector<std::size_t> glyphs;
+
+    bool empty() const
+    {
+        return tables.empty();
+    }
+};
+
+/// OpenType font made of tables.
+/// Parsing only reads the table directory and keeps the raw bytes of
+/// each table, which is parsed on first access. Tables that were never
+/// accessed for modification are written back byte-for-byte.
+/// Tables and glyphs of a const font may be read from several threads,
+/// each table being parsed once. Hashes are cached without locking, so
+/// comparing fonts is not safe while other threads compare or hash them.
 class Font : public OTFTable
 {
 public:
     Font();
-    virtual void parse(InputBuffer& dis) override;
+    virtual void parse(BufferView& dis) override;
+    void         parse(BufferView& dis, ParseOptions const& options);
+
+    /// Verify the checksums that parsing skipped or deferred.
+    /// Offsets in the error are relative to the beginning of the font.
+    ParseError verify_checksums() const;
+
+    /// Parse every table not parsed yet, from the view passed to parse().
+    /// Errors are reported like those of parse().
+    /// Independent tables are parsed on up to `num_threads` threads,
+    /// with the same results and errors as parsing them one by one.
+    void parse_tables(BufferView const& dis, unsigned num_threads = 1);
+
     virtual void compile(OutputBuffer& out) const override;
+
+    /// Compile each table into a buffer of its own on up to
+    /// `num_threads` threads, then lay them out.
+    /// The output is the same as that of compile(out).
+    void compile(OutputBuffer& out, unsigned num_threads) const;
+
+    /// Compile the font strictly in order, to streams that cannot seek.
+    /// Modified tables are compiled once and kept until the offset table
+    /// is written, and the others are copied from their bytes.
+    void compile(std::ostream& os) const;
+
+    /// Tables with different hashes are unequal without comparing them
     virtual bool operator==(OTFTable const& rhs) const noexcept override;
 
+    /// Tables and glyphs that differ from those of `other`,
+    /// found by their hashes and confirmed by comparing them
+    FontDiff diff(Font const& other) const;
+
+    /// Also forgets the hashes of all parsed tables
+    virtual void invalidate_hash() noexcept override;
+
+    /// Table with the given tag, parsed on first access, and marked as
+    /// modified so that it is compiled again.
+    /// Returns null when the font has no such table, or when it was left
+    /// out by ParseOptions::tables.
+    OTFTable* table(std::string const& tag);
+
+    /// Table with the given tag, parsed on first access
+    OTFTable const* table(std::string const& tag) const;
+
+    /// Table of type `T`, found by `T::tag` without comparing strings.
+    /// Parsed on first access and marked as modified.
+    template <typename T> T* table()
+    {
+        return static_cast<T*>(modify(pack_tag(T::tag)));
+    }
+
+    /// Table of type `T`, parsed on first access
+    template <typename T> T const* table() const
+    {
+        return static_cast<T const*>(load(pack_tag(T::tag)));
+    }
+
+    /// Whether the table with the given tag has been parsed
+    bool parsed(std::string const& tag) const;
+
+    /// Whether the table with the given tag may have been modified
+    bool modified(std::string const& tag) const;
+
+    /// Tags of all tables, in the order they are compiled
+    std::vector<std::string> tags() const;
+
+    /// Glyph of a character, marked as modified along with 'CFF '.
+    /// Throws std::runtime_error when the font has no 'cmap' or 'CFF '
+    /// table, or when either is malformed.
     Glyph& glyph(char32_t ch);
 
+protected:
+    /// Hash of the tags and the hashes of all tables, which are parsed
+    virtual uint64_t calculate_hash() const override;
+
 private:
-    std::map<std::string, std::unique_ptr<OTFTable>> tables;
+    friend class FontCollection;
+
+    struct Entry
+    {
+        uint32_t    tag = 0;
+        std::size_t offset = 0; // in the parsed input
+        std::size_t record = 0; // in the table directory
+        uint32_t    checksum = 0;
+        SharedBytes raw;
+
+        // null until parsed, which readers of a const font do under
+        // `parsing`
+        mutable std::unique_ptr<OTFTable> table;
+        std::unique_ptr<std::mutex>       parsing
+            = std::make_unique<std::mutex>();
+
+        // handed out for modification
+        bool dirty = false;
+
+        // left out by ParseOptions::tables: written back, never parsed
+        bool left_out = false;
+
+        /// Table to compile, or null to copy `raw`
+        OTFTable const* compiled() const
+        {
+            return dirty ? table.get() : nullptr;
+        }
+    };
+    // Sorted by tag
+    std::vector<Entry> tables;
+
+    // Offset table and table records as parsed
+    SharedBytes directory;
+
+    // Whether every table in the directory was read
+    bool complete = true;
+
+    /// Verify the checksums against `dis`, a view of the directory
+    void check_checksums(BufferView& dis) const;
+
+    /// Position and checksum of a compiled table
+    struct Record
+    {
+        uint32_t    tag = 0;
+        uint32_t    checksum = 0;
+        std::size_t offset = 0;
+        std::size_t length = 0;
+    };
+
+    /// Size of the offset table, including the table records
+    static std::size_t directory_size(std::size_t num_tables);
+
+    /// Write the offset table followed by the table records
+    static void
+        write_directory(OutputBuffer& out, std::vector<Record> const& records);
+
+    /// Compile a table padded to 4-byte boundary, and return its checksum.
+    /// Unmodified tables are copied from their bytes.
+    /// The position is left at the end of the unpadded table.
+    static uint32_t compile_entry(OutputBuffer& out, Entry const& entry);
+    Entry const* find(uint32_t tag) const;
+
+    /// Entry for `tag`, added in tag order if there is none
+    Entry& insert(uint32_t tag);
+
+    OTFTable const* load(uint32_t tag) const;
+    OTFTable*       modify(uint32_t tag);
+
+    /// Whether `entry` holds the same table as `rhs` of `other`.
+    /// Throws when either cannot be parsed.
+    bool same_table(Entry const& entry, Font const& other, Entry const& rhs)
+        const;
+    void            parse_table(Entry const& entry, BufferView& dis) const;
 };
 }
 
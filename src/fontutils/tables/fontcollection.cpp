@@ -0,0 +1,202 @@
+#include "fontcollection.hpp"
+
+#include "../checksum.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+
+namespace geul
+{
+
+FontCollection::FontCollection()
+    : OTFTable(tag)
+{}
+
+void FontCollection::parse(BufferView& dis)
+{
+    parse(dis, ParseOptions());
+}
+
+void FontCollection::parse(BufferView& dis, ParseOptions const& options)
+{
+    fonts.clear();
+
+    if (dis.peek<uint32_t>() != pack_tag(tag))
+        return dis.fail(ParseError::Code::unsupported, "Not a font collection");
+    dis.read<uint32_t>();
+
+    // Version 2 only adds a DSIG table, which is not kept
+    auto major_version = dis.peek<uint16_t>();
+    if (major_version != 1 && major_version != 2)
+        return dis.fail(
+            ParseError::Code::unsupported,
+            "Unsupported font collection version");
+    dis.read<uint16_t>();
+    // minorVersion
+    dis.read<uint16_t>();
+
+    auto num_fonts = dis.peek<uint32_t>();
+    if (num_fonts > dis.size() / 4)
+        return dis.fail(
+            ParseError::Code::bad_value, "Too many fonts in collection");
+    dis.read<uint32_t>();
+
+    std::vector<uint32_t> offsets(num_fonts);
+    dis.read<uint32_t>(offsets.data(), num_fonts);
+    if (dis.failed())
+        return;
+
+    // The font checksum covers a single font, so members only verify
+    // their table checksums
+    auto member_options = options;
+    if (options.checksums == ParseOptions::Checksums::verify)
+        member_options.checksums = ParseOptions::Checksums::skip;
+
+    for (auto offset : offsets)
+    {
+        Font font;
+        auto font_dis = dis.at(offset);
+        font.parse(font_dis, member_options);
+        if (dis.failed())
+            return;
+
+        font.complete = false;
+        if (options.checksums == ParseOptions::Checksums::verify)
+        {
+            auto directory_dis = dis.slice(offset, font.directory.size);
+            font.check_checksums(directory_dis);
+            if (dis.failed())
+                return;
+        }
+        fonts.push_back(std::move(font));
+    }
+
+    // Tables at the same place are the same bytes, even when they had to
+    // be copied out of the input
+    std::map<std::pair<std::size_t, std::size_t>, SharedBytes> shared;
+    for (auto& font : fonts)
+    {
+        for (auto& entry : font.tables)
+        {
+            auto key = std::make_pair(entry.offset, entry.raw.size);
+            auto it = shared.emplace(key, entry.raw).first;
+            entry.raw = it->second;
+        }
+    }
+}
+
+void FontCollection::compile(OutputBuffer& out) const
+{
+    // Table data, compiled once for each distinct content
+    struct Blob
+    {
+        OutputBuffer bytes;
+        uint32_t     checksum = 0;
+        std::size_t  length = 0;
+        std::size_t  offset = 0;
+    };
+    std::vector<Blob>                             blobs;
+    std::unordered_multimap<uint64_t, std::size_t> by_hash;
+
+    // Blob of each table of each font
+    std::vector<std::vector<std::size_t>> font_blobs;
+    for (auto const& font : fonts)
+    {
+        if (!font.find(pack_tag("head")))
+            throw std::runtime_error("'head' table not present");
+
+        font_blobs.emplace_back();
+        for (auto const& entry : font.tables)
+        {
+            Blob blob;
+            blob.checksum = Font::compile_entry(blob.bytes, entry);
+            blob.length = blob.bytes.tell();
+
+            auto span = blob.bytes.view().span();
+            auto hash = content_hash(span.data, span.size);
+            auto range = by_hash.equal_range(hash);
+            auto same = std::find_if(range.first, range.second, [&](auto pp) {
+                return blobs[pp.second].bytes.view().span() == span;
+            });
+
+            if (same != range.second)
+                font_blobs.back().push_back(same->second);
+            else
+            {
+                by_hash.emplace(hash, blobs.size());
+                font_blobs.back().push_back(blobs.size());
+                blobs.push_back(std::move(blob));
+            }
+        }
+    }
+
+    // Layout: header, the offset table of each font, then table data
+    std::size_t offset = 12 + 4 * fonts.size();
+    std::vector<std::size_t> directories;
+    for (auto const& font : fonts)
+    {
+        directories.push_back(offset);
+        offset += Font::directory_size(font.tables.size());
+    }
+    for (auto& blob : blobs)
+    {
+        blob.offset = offset;
+        offset += blob.bytes.size();
+    }
+
+    auto beginning = out.tell();
+    out.reserve(beginning + offset);
+
+    // TTC Header
+    out.write<uint32_t>(pack_tag(tag));
+    // majorVersion
+    out.write<uint16_t>(1);
+    // minorVersion
+    out.write<uint16_t>(0);
+    out.write<uint32_t>(fonts.size());
+    for (auto directory : directories)
+        out.write<uint32_t>(directory);
+
+    for (auto i = 0u; i < fonts.size(); ++i)
+    {
+        std::vector<Font::Record> records;
+        for (auto j = 0u; j < fonts[i].tables.size(); ++j)
+        {
+            auto const& blob = blobs[font_blobs[i][j]];
+
+            Font::Record record;
+            record.tag = fonts[i].tables[j].tag;
+            record.checksum = blob.checksum;
+            record.offset = blob.offset;
+            record.length = blob.length;
+            records.push_back(record);
+        }
+        Font::write_directory(out, records);
+    }
+
+    for (auto& blob : blobs)
+    {
+        auto span = blob.bytes.view().span();
+        out.write<char>(span.data, span.size);
+        blob.bytes = OutputBuffer();
+    }
+}
+
+bool FontCollection::operator==(OTFTable const& rhs) const noexcept
+{
+    assert(typeid(*this) == typeid(rhs));
+    auto const& other = static_cast<FontCollection const&>(rhs);
+
+    if (fonts.size() != other.fonts.size())
+        return false;
+
+    for (auto i = 0u; i < fonts.size(); ++i)
+        if (!(fonts[i] == other.fonts[i]))
+            return false;
+    return true;
+}
+}
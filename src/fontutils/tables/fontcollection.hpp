@@ -0,0 +1,30 @@
+#ifndef TABLES_FONT_COLLECTION_HPP
+#define TABLES_FONT_COLLECTION_HPP
+
+#include "font.hpp"
+
+#include <vector>
+
+namespace geul
+{
+
+/// OpenType Collection of fonts that may share tables.
+/// Members share the bytes of the tables they have in common, and
+/// compiling writes byte-identical tables once.
+class FontCollection : public OTFTable
+{
+public:
+    std::vector<Font> fonts;
+
+public:
+    FontCollection();
+    virtual void parse(BufferView& dis) override;
+    void         parse(BufferView& dis, ParseOptions const& options);
+    virtual void compile(OutputBuffer& out) const override;
+    virtual bool operator==(OTFTable const& rhs) const noexcept override;
+
+    static constexpr char const* tag = "ttcf";
+};
+}
+
+#endif
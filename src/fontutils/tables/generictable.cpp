@@ -1,5 +1,7 @@
 #include "generictable.hpp"
 
+#include "../checksum.hpp"
+
 #include <cassert>
 #include <typeinfo>
 
@@ -8,20 +10,19 @@ namespace geul
 
 GenericTable::GenericTable(std::string tag, std::size_t length)
     : OTFTable(std::move(tag))
-{
-    data.resize(length);
-}
+    , length(length)
+{}
 
-void GenericTable::parse(InputBuffer& dis)
+void GenericTable::parse(BufferView& dis)
 {
     std::cout << "Unsupported table '" << id() << "'... " << std::endl;
 
-    dis.read<char>(&data[0], data.size());
+    data = dis.read_shared(length);
 }
 
 void GenericTable::compile(OutputBuffer& out) const
 {
-    out.write_string(data);
+    out.write<char>(data.data.get(), data.size);
 }
 
 bool GenericTable::operator==(OTFTable const& rhs) const noexcept
@@ -30,4 +31,9 @@ bool GenericTable::operator==(OTFTable const& rhs) const noexcept
     auto const& other = static_cast<GenericTable const&>(rhs);
     return data == other.data;
 }
+
+uint64_t GenericTable::calculate_hash() const
+{
+    return content_hash(data.data.get(), data.size);
+}
 }
@@ -8,13 +8,19 @@ namespace geul
 
 class GenericTable : public OTFTable
 {
-    std::string data;
+    std::size_t length;
+
+    // Raw table bytes, shared with the source buffer when possible
+    SharedBytes data;
 
 public:
     GenericTable(std::string tag, std::size_t length);
-    virtual void parse(InputBuffer& dis) override;
+    virtual void parse(BufferView& dis) override;
     virtual void compile(OutputBuffer& out) const override;
     virtual bool operator==(OTFTable const& rhs) const noexcept override;
+
+protected:
+    virtual uint64_t calculate_hash() const override;
 };
 }
 
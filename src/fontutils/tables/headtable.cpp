@@ -1,5 +1,7 @@
 #include "headtable.hpp"
 
+#include "record.hpp"
+
 #include <cassert>
 #include <chrono>
 #include <ctime>
@@ -15,6 +17,27 @@ namespace
         std::time_t now = std::time(nullptr);
         return now + 2082844800;
     }
+
+    constexpr auto layout = record_layout(
+        field(&HeadTable::version),
+        field(&HeadTable::font_revision),
+        // checksumAdjustment, patched after the whole font is written
+        reserved<uint32_t>(),
+        constant<uint32_t>(0x5F0F3CF5, "Invalid magic number"),
+        field(&HeadTable::flags),
+        field(&HeadTable::units_per_em),
+        field(&HeadTable::created),
+        field(&HeadTable::modified),
+        field(&HeadTable::xmin),
+        field(&HeadTable::ymin),
+        field(&HeadTable::xmax),
+        field(&HeadTable::ymax),
+        field(&HeadTable::mac_style),
+        field(&HeadTable::lowest_PPEM),
+        field(&HeadTable::font_direction_hint),
+        // indexToLocFormat (short, Offset16)
+        constant<uint16_t>(0, "Unrecognized index to loc format"),
+        field(&HeadTable::glyph_data_format));
 }
 
 HeadTable::HeadTable()
@@ -29,86 +52,20 @@ HeadTable::HeadTable()
     // TODO: set glyph bounding box
 }
 
-void HeadTable::parse(InputBuffer& dis)
+void HeadTable::parse(BufferView& dis)
 {
-    version = dis.read<Fixed>();
+    read_record(dis, layout, *this);
     if (version != Fixed(0x00010000))
-        throw std::runtime_error("Unrecognized head table version");
-
-    // fontRevision
-    font_revision = dis.read<Fixed>();
-
-    // checksumAdjustment
-    dis.read<uint32_t>();
-
-    // magicNumber
-    if (dis.read<uint32_t>() != 0x5F0F3CF5)
-        throw std::runtime_error("Invalid magic number");
+        return dis.fail(
+            ParseError::Code::unsupported, "Unrecognized head table version");
 
-    flags = dis.read<uint16_t>();
-    units_per_em = dis.read<uint16_t>();
-    created = dis.read<int64_t>();
-    // modified
-    dis.read<int64_t>();
-    xmin = dis.read<int16_t>();
-    ymin = dis.read<int16_t>();
-    xmax = dis.read<int16_t>();
-    ymax = dis.read<int16_t>();
-    mac_style = dis.read<int16_t>();
-    lowest_PPEM = dis.read<int16_t>();
-    font_direction_hint = dis.read<uint16_t>();
-    auto index_to_loc_format = dis.read<uint16_t>();
-    if (index_to_loc_format != 0)
-        throw std::runtime_error("Unrecognized index to loc format");
-    glyph_data_format = dis.read<uint16_t>();
+    // not round-tripped: stamped when the table is made
+    modified = timestamp();
 }
 
 void HeadTable::compile(OutputBuffer& out) const
 {
-    // majorVersion
-    out.write<uint16_t>(1);
-    // minorVersion
-    out.write<uint16_t>(0);
-    // fontRevision
-    out.write<Fixed>(font_revision);
-
-    // Set to zero, directly written to the memory afterwards
-    out.write<uint32_t>(0);
-
-    // magicNumber
-    out.write<uint32_t>(0x5F0F3CF5);
-
-    // flags
-    out.write<uint16_t>(BASELINE_AT_ZERO | LSB_AT_ZERO);
-
-    // unitsPerEm
-    out.write<uint16_t>(units_per_em);
-
-    // created
-    out.write<int64_t>(created);
-    // modified
-    out.write<int64_t>(modified);
-
-    // bounding box for all glyphs
-    out.write<int16_t>(xmin);
-    out.write<int16_t>(ymin);
-    out.write<int16_t>(xmax);
-    out.write<int16_t>(ymax);
-
-    // macStyle
-    out.write<int16_t>(0);
-
-    // lowestRecPPEM
-    out.write<int16_t>(3);
-
-    // fontDirectionHint (deprecated, set to 2)
-    out.write<uint16_t>(2);
-
-    // indexToLocFormat (set to short, Offset16)
-    out.write<uint16_t>(0);
-
-    // glyphDataFormat (current)
-    out.write<uint16_t>(0);
+    write_record(out, layout, *this);
 }
 
 bool HeadTable::operator==(OTFTable const& rhs) const noexcept
@@ -124,4 +81,12 @@ bool HeadTable::operator==(OTFTable const& rhs) const noexcept
            && flags == other.flags && created == other.created;
     /* && modified == other.modified */;
 }
+
+uint64_t HeadTable::calculate_hash() const
+{
+    // stamped when the table is made, so not compared
+    auto unstamped = *this;
+    unstamped.modified = 0;
+    return unstamped.OTFTable::calculate_hash();
+}
 }
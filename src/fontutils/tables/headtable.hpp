@@ -19,16 +19,18 @@ public:
 
     uint16_t units_per_em = 1000;
 
-    uint16_t mac_style;
-    uint16_t lowest_PPEM;
-    int16_t  font_direction_hint;
+    uint16_t mac_style = 0;
+    uint16_t lowest_PPEM = 3;
 
-    int16_t glyph_data_format;
+    // deprecated, set to 2
+    int16_t font_direction_hint = 2;
 
-    Fixed version;
-    Fixed font_revision;
+    int16_t glyph_data_format = 0;
 
-    uint16_t flags;
+    Fixed version = Fixed(0x00010000);
+    Fixed font_revision = Fixed(0x00010000);
+
+    uint16_t flags = BASELINE_AT_ZERO | LSB_AT_ZERO;
 
     uint64_t created;
     uint64_t modified;
@@ -43,11 +45,15 @@ public:
 
 public:
     HeadTable();
-    virtual void parse(InputBuffer& dis) override;
+    virtual void parse(BufferView& dis) override;
     virtual void compile(OutputBuffer& out) const override;
     virtual bool operator==(OTFTable const& rhs) const noexcept override;
 
     static constexpr char const* tag = "head";
+
+protected:
+    /// Hash of the compiled table, without the time it was modified
+    virtual uint64_t calculate_hash() const override;
 };
 }
 
@@ -1,71 +1,51 @@
 #include "hheatable.hpp"
 
+#include "record.hpp"
+
 #include <cassert>
 #include <typeinfo>
 
 namespace geul
 {
 
+namespace
+{
+constexpr auto layout = record_layout(
+    constant<uint16_t>(1, "Unrecognized hhea table major version"),
+    constant<uint16_t>(0, "Unrecognized hhea table minor version"),
+    field(&HheaTable::ascender),
+    field(&HheaTable::descender),
+    field(&HheaTable::line_gap),
+    field(&HheaTable::advance_width_max),
+    field(&HheaTable::min_lsb),
+    field(&HheaTable::max_lsb),
+    field(&HheaTable::x_max_extent),
+    field(&HheaTable::caret_slope_rise),
+    field(&HheaTable::caret_slope_run),
+    field(&HheaTable::caret_offset),
+    reserved<int16_t>(),
+    reserved<int16_t>(),
+    reserved<int16_t>(),
+    reserved<int16_t>(),
+    field(&HheaTable::metric_data_format),
+    field(&HheaTable::num_h_metrics));
+}
+
 HheaTable::HheaTable()
     : OTFTable(tag)
 {}
 
-void HheaTable::parse(InputBuffer& dis)
+void HheaTable::parse(BufferView& dis)
 {
-    auto major_version = dis.read<uint16_t>();
-    if (major_version != 1)
-        throw std::runtime_error("Unrecognized head table major version");
-    auto minor_version = dis.read<uint16_t>();
-    if (minor_version != 0)
-        throw std::runtime_error("Unrecognized head table minor version");
-    ascender = dis.read<int16_t>();
-    descender = dis.read<int16_t>();
-    line_gap = dis.read<int16_t>();
-    advance_width_max = dis.read<uint16_t>();
-    min_lsb = dis.read<int16_t>();
-    max_lsb = dis.read<int16_t>();
-    x_max_extent = dis.read<int16_t>();
-    caret_slope_rise = dis.read<int16_t>();
-    caret_slope_run = dis.read<int16_t>();
-    caret_offset = dis.read<int16_t>();
-
-    // reserved
-    dis.read<int16_t>();
-    dis.read<int16_t>();
-    dis.read<int16_t>();
-    dis.read<int16_t>();
-
-    metric_data_format = dis.read<int16_t>();
+    read_record(dis, layout, *this);
     if (metric_data_format != 0)
-        throw std::runtime_error("Unrecognized metric data format");
-    num_h_metrics = dis.read<uint16_t>();
+        return dis.fail(
+            ParseError::Code::unsupported, "Unrecognized metric data format");
 }
 
 void HheaTable::compile(OutputBuffer& out) const
 {
-    // version
-    out.write<uint16_t>(1);
-    out.write<uint16_t>(0);
-
-    out.write<int16_t>(ascender);
-    out.write<int16_t>(descender);
-    out.write<int16_t>(line_gap);
-    out.write<uint16_t>(advance_width_max);
-    out.write<int16_t>(min_lsb);
-    out.write<int16_t>(max_lsb);
-    out.write<int16_t>(x_max_extent);
-    out.write<int16_t>(caret_slope_rise);
-    out.write<int16_t>(caret_slope_run);
-    out.write<int16_t>(caret_offset);
-
-    // reserved
-    out.write<int16_t>(0);
-    out.write<int16_t>(0);
-    out.write<int16_t>(0);
-    out.write<int16_t>(0);
-
-    out.write<int16_t>(metric_data_format);
-    out.write<uint16_t>(num_h_metrics);
+    write_record(out, layout, *this);
 }
 
 bool HheaTable::operator==(OTFTable const& rhs) const noexcept
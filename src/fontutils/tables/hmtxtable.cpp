@@ -1,5 +1,7 @@
 #include "hmtxtable.hpp"
 
+#include "../checksum.hpp"
+
 #include <cassert>
 #include <typeinfo>
 
@@ -12,12 +14,15 @@ HmtxTable::HmtxTable(std::size_t num_glyphs, std::size_t num_h_metrics)
     , lsbs(num_glyphs - num_h_metrics)
 {}
 
-void HmtxTable::parse(InputBuffer& dis)
+void HmtxTable::parse(BufferView& dis)
 {
-    for (auto& metric : metrics)
+    // advanceWidth and lsb pairs
+    std::vector<uint16_t> h_metrics(metrics.size() * 2);
+    dis.read<uint16_t>(h_metrics.data(), h_metrics.size());
+    for (auto i = 0u; i < metrics.size(); ++i)
     {
-        metric.advance_width = dis.read<uint16_t>();
-        metric.lsb = dis.read<int16_t>();
+        metrics[i].advance_width = h_metrics[i * 2];
+        metrics[i].lsb = h_metrics[i * 2 + 1];
     }
 
     dis.read<int16_t>(lsbs.data(), lsbs.size());
@@ -25,11 +30,14 @@ void HmtxTable::parse(InputBuffer& dis)
 
 void HmtxTable::compile(OutputBuffer& out) const
 {
+    std::vector<uint16_t> h_metrics;
+    h_metrics.reserve(metrics.size() * 2);
     for (auto const& metric : metrics)
     {
-        out.write<uint16_t>(metric.advance_width);
-        out.write<int16_t>(metric.lsb);
+        h_metrics.push_back(metric.advance_width);
+        h_metrics.push_back(metric.lsb);
     }
+    out.write<uint16_t>(h_metrics.data(), h_metrics.size());
 
     out.write(lsbs.data(), lsbs.size());
 }
@@ -41,6 +49,16 @@ bool HmtxTable::operator==(OTFTable const& rhs) const noexcept
     return metrics == other.metrics && lsbs == other.lsbs;
 }
 
+uint64_t HmtxTable::calculate_hash() const
+{
+    auto hash = content_hash(
+        reinterpret_cast<char const*>(metrics.data()),
+        metrics.size() * sizeof(HMetric));
+    return content_hash(
+        reinterpret_cast<char const*>(lsbs.data()),
+        lsbs.size() * sizeof(int16_t), hash);
+}
+
 bool HmtxTable::HMetric::operator==(HMetric const& rhs) const noexcept
 {
     return advance_width == rhs.advance_width && lsb == rhs.lsb;
@@ -24,11 +24,14 @@ public:
 
 public:
     HmtxTable(std::size_t num_glyphs, std::size_t num_h_metrics);
-    virtual void parse(InputBuffer& dis) override;
+    virtual void parse(BufferView& dis) override;
     virtual void compile(OutputBuffer& out) const override;
     virtual bool operator==(OTFTable const& rhs) const noexcept override;
 
     static constexpr char const* tag = "hmtx";
+
+protected:
+    virtual uint64_t calculate_hash() const override;
 };
 }
 
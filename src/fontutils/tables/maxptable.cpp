@@ -1,39 +1,37 @@
 #include "maxptable.hpp"
 
+#include "record.hpp"
+
 #include <cassert>
 #include <typeinfo>
 
 namespace geul
 {
 
+namespace
+{
+constexpr auto layout = record_layout(
+    field(&MaxpTable::version), field<uint16_t>(&MaxpTable::num_glyphs));
+}
+
 MaxpTable::MaxpTable()
     : OTFTable(tag)
 {}
 
-void MaxpTable::parse(InputBuffer& dis)
+void MaxpTable::parse(BufferView& dis)
 {
-    version = dis.read<Fixed>();
-    if (version == Fixed(0x00005000))
-    {
-        num_glyphs = dis.read<uint16_t>();
-    }
-    else
-    {
-        throw std::runtime_error("CFF fonts must have version 0.5 maxp table");
-    }
+    if (dis.peek<Fixed>() != Fixed(0x00005000))
+        return dis.fail(
+            ParseError::Code::unsupported,
+            "CFF fonts must have version 0.5 maxp table");
+    read_record(dis, layout, *this);
 }
 
 void MaxpTable::compile(OutputBuffer& out) const
 {
-    if (version == Fixed(0x00005000))
-    {
-        out.write<Fixed>(version);
-        out.write<uint16_t>(num_glyphs);
-    }
-    else
-    {
+    if (version != Fixed(0x00005000))
         throw std::runtime_error("CFF fonts must have version 0.5 maxp table");
-    }
+    write_record(out, layout, *this);
 }
 
 bool MaxpTable::operator==(OTFTable const& rhs) const noexcept
@@ -10,7 +10,7 @@ NameTable::NameTable()
     : OTFTable(tag)
 {}
 
-void NameTable::parse(InputBuffer& dis)
+void NameTable::parse(BufferView& dis)
 {
     std::size_t beginning = dis.tell();
 
@@ -32,17 +32,15 @@ void NameTable::parse(InputBuffer& dis)
 
             record.str.resize(len);
 
-            {
-                auto lock = dis.seek_lock(beginning + offset + stroff);
-                dis.read<char>(&record.str[0], len);
-            }
+            dis.read_at<char>(beginning + offset + stroff, &record.str[0], len);
 
             records.push_back(record);
         }
     }
     else
     {
-        throw std::runtime_error("Unrecognized name table format");
+        dis.fail(
+            ParseError::Code::unsupported, "Unrecognized name table format");
     }
 }
 
@@ -1,143 +1,97 @@
 #include "os2table.hpp"
 
+#include "record.hpp"
+
 #include <cassert>
 #include <typeinfo>
 
 namespace geul
 {
 
+namespace
+{
+using Panose = OS2Table::Panose;
+using UnicodeRange = OS2Table::UnicodeRange;
+using CodepageRange = OS2Table::CodepageRange;
+
+// versions 3 and 4 share the same layout
+constexpr auto layout = record_layout(
+    field(&OS2Table::version),
+    field(&OS2Table::x_avg_char_width),
+    field(&OS2Table::us_weight_class),
+    field(&OS2Table::us_width_class),
+    field(&OS2Table::fs_type),
+    field(&OS2Table::y_subscript_x_size),
+    field(&OS2Table::y_subscript_y_size),
+    field(&OS2Table::y_subscript_x_offset),
+    field(&OS2Table::y_subscript_y_offset),
+    field(&OS2Table::y_superscript_x_size),
+    field(&OS2Table::y_superscript_y_size),
+    field(&OS2Table::y_superscript_x_offset),
+    field(&OS2Table::y_superscript_y_offset),
+    field(&OS2Table::y_strikeout_size),
+    field(&OS2Table::y_strikeout_position),
+    field(&OS2Table::s_family_class),
+    nested(
+        &OS2Table::panose,
+        record_layout(
+            field(&Panose::b_family_type),
+            field(&Panose::b_serif_type),
+            field(&Panose::b_weight),
+            field(&Panose::b_proportion),
+            field(&Panose::b_contrast),
+            field(&Panose::b_stroke_variation),
+            field(&Panose::b_arm_style),
+            field(&Panose::b_letterform),
+            field(&Panose::b_midline),
+            field(&Panose::b_x_height))),
+    nested(
+        &OS2Table::ul_unicode_range,
+        record_layout(
+            field(&UnicodeRange::ul_unicode_range_1),
+            field(&UnicodeRange::ul_unicode_range_2),
+            field(&UnicodeRange::ul_unicode_range_3),
+            field(&UnicodeRange::ul_unicode_range_4))),
+    field(&OS2Table::ach_vend_id),
+    field(&OS2Table::fs_selection),
+    field(&OS2Table::us_first_char_index),
+    field(&OS2Table::us_last_char_index),
+    field(&OS2Table::s_typo_ascender),
+    field(&OS2Table::s_typo_descender),
+    field(&OS2Table::s_typo_line_gap),
+    field(&OS2Table::us_win_ascent),
+    field(&OS2Table::us_win_descent),
+    nested(
+        &OS2Table::ul_codepage_range,
+        record_layout(
+            field(&CodepageRange::ul_codepage_range_1),
+            field(&CodepageRange::ul_codepage_range_2))),
+    field(&OS2Table::s_x_height),
+    field(&OS2Table::s_cap_height),
+    field(&OS2Table::us_default_char),
+    field(&OS2Table::us_break_char),
+    field(&OS2Table::us_max_context));
+}
+
 OS2Table::OS2Table()
     : OTFTable(tag)
 {}
 
-void OS2Table::parse(InputBuffer& dis)
+void OS2Table::parse(BufferView& dis)
 {
-    version = dis.read<uint16_t>();
-    if (version == 3 || version == 4)
-    {
-        x_avg_char_width = dis.read<int16_t>();
-        us_weight_class = dis.read<uint16_t>();
-        us_width_class = dis.read<uint16_t>();
-        fs_type = dis.read<uint16_t>();
-        y_subscript_x_size = dis.read<int16_t>();
-        y_subscript_y_size = dis.read<int16_t>();
-        y_subscript_x_offset = dis.read<int16_t>();
-        y_subscript_y_offset = dis.read<int16_t>();
-        y_superscript_x_size = dis.read<int16_t>();
-        y_superscript_y_size = dis.read<int16_t>();
-        y_superscript_x_offset = dis.read<int16_t>();
-        y_superscript_y_offset = dis.read<int16_t>();
-        y_strikeout_size = dis.read<int16_t>();
-        y_strikeout_position = dis.read<int16_t>();
-        s_family_class = dis.read<int16_t>();
-
-        // panose
-        panose.b_family_type = dis.read<uint8_t>();
-        panose.b_serif_type = dis.read<uint8_t>();
-        panose.b_weight = dis.read<uint8_t>();
-        panose.b_proportion = dis.read<uint8_t>();
-        panose.b_contrast = dis.read<uint8_t>();
-        panose.b_stroke_variation = dis.read<uint8_t>();
-        panose.b_arm_style = dis.read<uint8_t>();
-        panose.b_letterform = dis.read<uint8_t>();
-        panose.b_midline = dis.read<uint8_t>();
-        panose.b_x_height = dis.read<uint8_t>();
-
-        // Unicode range
-        ul_unicode_range.ul_unicode_range_1 = dis.read<uint32_t>();
-        ul_unicode_range.ul_unicode_range_2 = dis.read<uint32_t>();
-        ul_unicode_range.ul_unicode_range_3 = dis.read<uint32_t>();
-        ul_unicode_range.ul_unicode_range_4 = dis.read<uint32_t>();
-
-        dis.read<uint8_t>(ach_vend_id.data(), 4);
-        fs_selection = dis.read<uint16_t>();
-        us_first_char_index = dis.read<uint16_t>();
-        us_last_char_index = dis.read<uint16_t>();
-        s_typo_ascender = dis.read<int16_t>();
-        s_typo_descender = dis.read<int16_t>();
-        s_typo_line_gap = dis.read<int16_t>();
-        us_win_ascent = dis.read<uint16_t>();
-        us_win_descent = dis.read<uint16_t>();
-
-        // Codepage range
-        ul_codepage_range.ul_codepage_range_1 = dis.read<uint32_t>();
-        ul_codepage_range.ul_codepage_range_2 = dis.read<uint32_t>();
-
-        s_x_height = dis.read<int16_t>();
-        s_cap_height = dis.read<int16_t>();
-        us_default_char = dis.read<uint16_t>();
-        us_break_char = dis.read<uint16_t>();
-        us_max_context = dis.read<uint16_t>();
-    }
-    else
-    {
-        throw std::runtime_error("Unsupported version of the OS/2 table.");
-    }
+    auto version = dis.peek<uint16_t>();
+    if (version != 3 && version != 4)
+        return dis.fail(
+            ParseError::Code::unsupported,
+            "Unsupported version of the OS/2 table.");
+    read_record(dis, layout, *this);
 }
 
 void OS2Table::compile(OutputBuffer& out) const
 {
-    if (version == 3 || version == 4)
-    {
-        out.write<uint16_t>(version);
-        out.write<int16_t>(x_avg_char_width);
-        out.write<uint16_t>(us_weight_class);
-        out.write<uint16_t>(us_width_class);
-        out.write<uint16_t>(fs_type);
-        out.write<int16_t>(y_subscript_x_size);
-        out.write<int16_t>(y_subscript_y_size);
-        out.write<int16_t>(y_subscript_x_offset);
-        out.write<int16_t>(y_subscript_y_offset);
-        out.write<int16_t>(y_superscript_x_size);
-        out.write<int16_t>(y_superscript_y_size);
-        out.write<int16_t>(y_superscript_x_offset);
-        out.write<int16_t>(y_superscript_y_offset);
-        out.write<int16_t>(y_strikeout_size);
-        out.write<int16_t>(y_strikeout_position);
-        out.write<int16_t>(s_family_class);
-
-        // panose
-        out.write<uint8_t>(panose.b_family_type);
-        out.write<uint8_t>(panose.b_serif_type);
-        out.write<uint8_t>(panose.b_weight);
-        out.write<uint8_t>(panose.b_proportion);
-        out.write<uint8_t>(panose.b_contrast);
-        out.write<uint8_t>(panose.b_stroke_variation);
-        out.write<uint8_t>(panose.b_arm_style);
-        out.write<uint8_t>(panose.b_letterform);
-        out.write<uint8_t>(panose.b_midline);
-        out.write<uint8_t>(panose.b_x_height);
-
-        // unicode range
-        out.write<uint32_t>(ul_unicode_range.ul_unicode_range_1);
-        out.write<uint32_t>(ul_unicode_range.ul_unicode_range_2);
-        out.write<uint32_t>(ul_unicode_range.ul_unicode_range_3);
-        out.write<uint32_t>(ul_unicode_range.ul_unicode_range_4);
-
-        out.write<uint8_t>(ach_vend_id.data(), 4);
-        out.write<uint16_t>(fs_selection);
-        out.write<uint16_t>(us_first_char_index);
-        out.write<uint16_t>(us_last_char_index);
-        out.write<int16_t>(s_typo_ascender);
-        out.write<int16_t>(s_typo_descender);
-        out.write<int16_t>(s_typo_line_gap);
-        out.write<uint16_t>(us_win_ascent);
-        out.write<uint16_t>(us_win_descent);
-
-        // codepage range
-        out.write<uint32_t>(ul_codepage_range.ul_codepage_range_1);
-        out.write<uint32_t>(ul_codepage_range.ul_codepage_range_2);
-
-        out.write<int16_t>(s_x_height);
-        out.write<int16_t>(s_cap_height);
-        out.write<uint16_t>(us_default_char);
-        out.write<uint16_t>(us_break_char);
-        out.write<uint16_t>(us_max_context);
-    }
-    else
-    {
+    if (version != 3 && version != 4)
         throw std::runtime_error("Unsupported version of the OS/2 table.");
-    }
+    write_record(out, layout, *this);
 }
 
 bool OS2Table::operator==(OTFTable const& rhs) const noexcept
@@ -1,5 +1,7 @@
 #include "otftable.hpp"
 
+#include "../checksum.hpp"
+
 #include <cmath>
 
 namespace geul
@@ -14,19 +16,45 @@ std::string OTFTable::id() const
     return id_;
 }
 
-uint32_t calculate_checksum(InputBuffer& dis, std::size_t length)
+uint64_t OTFTable::hash() const
 {
-    uint32_t checksum = 0;
-    uint32_t l;
-
-    l = (length % 4 > 0) ? length / 4 + 1 : length / 4;
-
-    for (uint32_t i = 0; i < l; i++)
+    if (!hashed_)
     {
-        checksum += dis.read<uint32_t>();
+        hash_ = calculate_hash();
+        hashed_ = true;
     }
+    return hash_;
+}
 
-    return checksum;
+void OTFTable::invalidate_hash() noexcept
+{
+    hashed_ = false;
+}
+
+uint64_t OTFTable::calculate_hash() const
+{
+    // Tables that compare equal compile to the same bytes
+    OutputBuffer out;
+    compile(out);
+    auto bytes = out.view().span();
+    return content_hash(
+        bytes.data, bytes.size, content_hash(id_.data(), id_.size()));
+}
+
+uint32_t pack_tag(std::string const& tag)
+{
+    return tag.size() == 4 ? pack_tag(tag.data()) : 0;
+}
+
+std::string unpack_tag(uint32_t tag)
+{
+    return { char(tag >> 24), char(tag >> 16), char(tag >> 8), char(tag) };
+}
+
+uint32_t calculate_checksum(BufferView dis, std::size_t length)
+{
+    auto span = dis.read_span(length);
+    return checksum(span.data, span.size);
 }
 
 int le_pow2(int num)
@@ -21,23 +21,60 @@ public:
 
     virtual ~OTFTable() = default;
 
+    OTFTable(OTFTable const&) = default;
+    OTFTable(OTFTable&&) = default;
+    OTFTable& operator=(OTFTable const&) = default;
+    OTFTable& operator=(OTFTable&&) = default;
+
     /// Compile the table into a Buffer.
     /// DOES NOT pad the end of the buffer.
     virtual void compile(OutputBuffer& out) const = 0;
 
     /// Parse the buffer starting from the current position.
-    virtual void parse(InputBuffer& dis) = 0;
+    virtual void parse(BufferView& dis) = 0;
 
     /// Compare equality
     virtual bool operator==(OTFTable const& rhs) const noexcept = 0;
 
+    /// Hash of the contents, the same for tables that compare equal.
+    /// Cached until invalidate_hash() is called, which Font does when
+    /// it hands out a table for modification.
+    uint64_t hash() const;
+
+    /// Forget the cached hash, after the table is changed
+    virtual void invalidate_hash() noexcept;
+
     std::string id() const;
 
+protected:
+    /// Hash of the contents. By default the tag and the compiled bytes
+    /// are hashed, which tables with a cheaper hash override.
+    virtual uint64_t calculate_hash() const;
+
 private:
     std::string id_;
+
+    mutable uint64_t hash_ = 0;
+    mutable bool     hashed_ = false;
 };
 
-uint32_t calculate_checksum(InputBuffer& dis, std::size_t length);
+/// 4-character table tag packed big-endian into an integer,
+/// so that packed tags sort like the tag strings
+constexpr uint32_t pack_tag(char const* tag)
+{
+    return uint32_t(uint8_t(tag[0])) << 24 | uint32_t(uint8_t(tag[1])) << 16
+           | uint32_t(uint8_t(tag[2])) << 8 | uint32_t(uint8_t(tag[3]));
+}
+
+/// Packed tag of a tag string, or 0 when it is not 4 bytes long
+uint32_t pack_tag(std::string const& tag);
+
+/// Tag string of a packed tag
+std::string unpack_tag(uint32_t tag);
+
+/// Checksum of `length` bytes from the current position,
+/// zero-padding the last word
+uint32_t calculate_checksum(BufferView dis, std::size_t length);
 
 /// Biggest power-of-2 less than or equal to num
 int le_pow2(int num);
@@ -1,39 +1,39 @@
 #include "posttable.hpp"
 
+#include "record.hpp"
+
 #include <cassert>
 #include <typeinfo>
 
 namespace geul
 {
 
+namespace
+{
+constexpr auto layout = record_layout(
+    field(&PostTable::version),
+    field(&PostTable::italic_angle),
+    field(&PostTable::underline_position),
+    field(&PostTable::underline_thickness),
+    field(&PostTable::is_fixed_pitch),
+    field(&PostTable::min_mem_type_42),
+    field(&PostTable::max_mem_type_42),
+    field(&PostTable::min_mem_type_1),
+    field(&PostTable::max_mem_type_1));
+}
+
 PostTable::PostTable()
     : OTFTable(tag)
 {}
 
-void PostTable::parse(InputBuffer& dis)
+void PostTable::parse(BufferView& dis)
 {
-    version = dis.read<Fixed>();
-    italic_angle = dis.read<Fixed>();
-    underline_position = dis.read<int16_t>();
-    underline_thickness = dis.read<int16_t>();
-    is_fixed_pitch = dis.read<uint32_t>();
-    min_mem_type_42 = dis.read<uint32_t>();
-    max_mem_type_42 = dis.read<uint32_t>();
-    min_mem_type_1 = dis.read<uint32_t>();
-    max_mem_type_1 = dis.read<uint32_t>();
+    read_record(dis, layout, *this);
 }
 
 void PostTable::compile(OutputBuffer& out) const
 {
-    out.write<Fixed>(version);
-    out.write<Fixed>(italic_angle);
-    out.write<int16_t>(underline_position);
-    out.write<int16_t>(underline_thickness);
-    out.write<uint32_t>(is_fixed_pitch);
-    out.write<uint32_t>(min_mem_type_42);
-    out.write<uint32_t>(max_mem_type_42);
-    out.write<uint32_t>(min_mem_type_1);
-    out.write<uint32_t>(max_mem_type_1);
+    write_record(out, layout, *this);
 }
 
 bool PostTable::operator==(OTFTable const& rhs) const noexcept
@@ -0,0 +1,240 @@
+#ifndef TABLES_RECORD_HPP
+#define TABLES_RECORD_HPP
+
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <tuple>
+#include <utility>
+
+#include "../buffer.hpp"
+
+namespace geul
+{
+
+namespace detail
+{
+/// Big-endian encoding of a single value
+template <typename T> struct Codec
+{
+    static constexpr std::size_t size = sizeof(T);
+
+    static void decode(char const* src, T& val)
+    {
+        val = to_machine_endian<T>(src);
+    }
+
+    static void encode(char* dest, T const& val)
+    {
+        to_big_endian<T>(dest, val);
+    }
+};
+
+template <typename T, std::size_t N> struct Codec<std::array<T, N>>
+{
+    static constexpr std::size_t size = sizeof(T) * N;
+
+    static void decode(char const* src, std::array<T, N>& arr)
+    {
+        to_machine_endian<T>(src, arr.data(), N);
+    }
+
+    static void encode(char* dest, std::array<T, N> const& arr)
+    {
+        to_big_endian<T>(dest, arr.data(), N);
+    }
+};
+
+/// Sum of the first `count` sizes
+constexpr std::size_t
+    prefix_sum(std::initializer_list<std::size_t> sizes, std::size_t count)
+{
+    std::size_t total = 0;
+    for (auto it = sizes.begin(); count > 0; ++it, --count)
+        total += *it;
+    return total;
+}
+}
+
+/// Field held in a data member, stored as `Stored` in the font file
+template <typename Class, typename Member, typename Stored> struct MemberField
+{
+    Member Class::*ptr;
+
+    static constexpr std::size_t size = detail::Codec<Stored>::size;
+
+    char const* decode(char const* src, Class& obj) const
+    {
+        Stored val;
+        detail::Codec<Stored>::decode(src, val);
+        obj.*ptr = static_cast<Member>(val);
+        return nullptr;
+    }
+
+    void encode(char* dest, Class const& obj) const
+    {
+        detail::Codec<Stored>::encode(dest, static_cast<Stored>(obj.*ptr));
+    }
+};
+
+/// Field that always has the same value.
+/// Parsing fails with `error` on any other value,
+/// or accepts anything when `error` is null.
+template <typename T> struct ConstantField
+{
+    T           value;
+    char const* error;
+
+    static constexpr std::size_t size = sizeof(T);
+
+    template <typename Class>
+    char const* decode(char const* src, Class&) const
+    {
+        if (error && to_machine_endian<T>(src) != value)
+            return error;
+        return nullptr;
+    }
+
+    template <typename Class> void encode(char* dest, Class const&) const
+    {
+        to_big_endian<T>(dest, value);
+    }
+};
+
+/// Struct member laid out by a layout of its own
+template <typename Class, typename Sub, typename Layout> struct NestedField
+{
+    Sub Class::*ptr;
+    Layout      layout;
+
+    static constexpr std::size_t size = Layout::size;
+
+    char const* decode(char const* src, Class& obj) const
+    {
+        return layout.decode(src, obj.*ptr);
+    }
+
+    void encode(char* dest, Class const& obj) const
+    {
+        layout.encode(dest, obj.*ptr);
+    }
+};
+
+/// Fixed-size record made of consecutive fields.
+/// The same description drives both parsing and compiling.
+template <typename... Fields> struct RecordLayout
+{
+    std::tuple<Fields...> fields;
+
+    static constexpr std::size_t size
+        = detail::prefix_sum({ Fields::size... }, sizeof...(Fields));
+
+    /// Decode the record from `size` bytes at `src`.
+    /// Returns the error of the first mismatching constant, if any.
+    template <typename Class>
+    char const* decode(char const* src, Class& obj) const
+    {
+        return decode(src, obj, std::index_sequence_for<Fields...>());
+    }
+
+    /// Encode the record into `size` bytes at `dest`
+    template <typename Class> void encode(char* dest, Class const& obj) const
+    {
+        encode(dest, obj, std::index_sequence_for<Fields...>());
+    }
+
+private:
+    template <std::size_t I> static constexpr std::size_t offset()
+    {
+        return detail::prefix_sum({ Fields::size... }, I);
+    }
+
+    template <typename Class, std::size_t... I>
+    char const*
+        decode(char const* src, Class& obj, std::index_sequence<I...>) const
+    {
+        char const* errors[] = {
+            nullptr, std::get<I>(fields).decode(src + offset<I>(), obj)...
+        };
+        for (auto error : errors)
+            if (error)
+                return error;
+        return nullptr;
+    }
+
+    template <typename Class, std::size_t... I>
+    void encode(char* dest, Class const& obj, std::index_sequence<I...>) const
+    {
+        int expand[] = {
+            0, (std::get<I>(fields).encode(dest + offset<I>(), obj), 0)...
+        };
+        (void)expand;
+    }
+};
+
+template <typename... Fields>
+constexpr RecordLayout<Fields...> record_layout(Fields... fields)
+{
+    return { std::make_tuple(fields...) };
+}
+
+/// Field stored with the type of the member
+template <typename Class, typename Member>
+constexpr MemberField<Class, Member, Member> field(Member Class::*ptr)
+{
+    return { ptr };
+}
+
+/// Field stored as `Stored`, converted from and to the member type
+template <typename Stored, typename Class, typename Member>
+constexpr MemberField<Class, Member, Stored> field(Member Class::*ptr)
+{
+    return { ptr };
+}
+
+template <typename T>
+constexpr ConstantField<T> constant(T value, char const* error = nullptr)
+{
+    return { value, error };
+}
+
+/// Reserved field, written as zero and ignored when parsing
+template <typename T> constexpr ConstantField<T> reserved()
+{
+    return { T(0), nullptr };
+}
+
+template <typename Class, typename Sub, typename Layout>
+constexpr NestedField<Class, Sub, Layout>
+    nested(Sub Class::*ptr, Layout layout)
+{
+    return { ptr, layout };
+}
+
+/// Read a record with a single bounds check
+template <typename Layout, typename Class>
+void read_record(BufferView& dis, Layout const& layout, Class& obj)
+{
+    auto pos = dis.tell();
+    auto span = dis.read_span(Layout::size);
+    if (span.size != Layout::size)
+        return;
+
+    if (auto error = layout.decode(span.data, obj))
+    {
+        dis.seek(pos);
+        dis.fail(ParseError::Code::unsupported, error);
+    }
+}
+
+/// Write a record with a single append
+template <typename Layout, typename Class>
+void write_record(OutputBuffer& out, Layout const& layout, Class const& obj)
+{
+    char bytes[Layout::size];
+    layout.encode(bytes, obj);
+    out.write<char>(bytes, Layout::size);
+}
+}
+
+#endif // TABLES_RECORD_HPP
@@ -1,65 +1,46 @@
 #include "vheatable.hpp"
+
+#include "record.hpp"
 #include <cassert>
 
 namespace geul
 {
 
+namespace
+{
+constexpr auto layout = record_layout(
+    constant<uint16_t>(1, "Unsupported vhea major version"),
+    field(&VheaTable::minor_version),
+    field(&VheaTable::ascender), // ascent in 1.0
+    field(&VheaTable::descender), // descent in 1.0
+    field(&VheaTable::line_gap),
+    field(&VheaTable::adv_height_max),
+    field(&VheaTable::min_top_side_bearing),
+    field(&VheaTable::min_bot_side_bearing),
+    field(&VheaTable::y_max_extent),
+    field(&VheaTable::caret_slope_rise),
+    field(&VheaTable::caret_slope_run),
+    field(&VheaTable::caret_offset),
+    reserved<int16_t>(),
+    reserved<int16_t>(),
+    reserved<int16_t>(),
+    reserved<int16_t>(),
+    reserved<int16_t>(),
+    field(&VheaTable::num_long_ver_metrics));
+}
+
 VheaTable::VheaTable()
     : OTFTable(tag)
 {}
 
-void VheaTable::parse(InputBuffer& dis)
+void VheaTable::parse(BufferView& dis)
 {
-    auto major = dis.read<uint16_t>();
-    if (major != 1)
-        throw std::runtime_error("Unsupported vhea major version");
-
-    minor_version = dis.read<uint16_t>();
-
-    ascender = dis.read<int16_t>(); // ascent in 1.0
-    descender = dis.read<int16_t>(); // descent in 1.0
-    line_gap = dis.read<int16_t>();
-    adv_height_max = dis.read<int16_t>();
-    min_top_side_bearing = dis.read<int16_t>();
-    min_bot_side_bearing = dis.read<int16_t>();
-    y_max_extent = dis.read<int16_t>();
-    caret_slope_rise = dis.read<int16_t>();
-    caret_slope_run = dis.read<int16_t>();
-    caret_offset = dis.read<int16_t>();
-
-    // reserved fields
-    dis.read<int16_t>();
-    dis.read<int16_t>();
-    dis.read<int16_t>();
-    dis.read<int16_t>();
-    dis.read<int16_t>();
-
-    num_long_ver_metrics = dis.read<uint16_t>();
+    read_record(dis, layout, *this);
 }
 
 void VheaTable::compile(OutputBuffer& out) const
 {
-    out.write<uint16_t>(1);
-    out.write<uint16_t>(minor_version);
-
-    out.write<int16_t>(ascender);
-    out.write<int16_t>(descender);
-    out.write<int16_t>(line_gap);
-    out.write<int16_t>(adv_height_max);
-    out.write<int16_t>(min_top_side_bearing);
-    out.write<int16_t>(min_bot_side_bearing);
-    out.write<int16_t>(y_max_extent);
-    out.write<int16_t>(caret_slope_rise);
-    out.write<int16_t>(caret_slope_run);
-    out.write<int16_t>(caret_offset);
-
-    out.write<int16_t>(0);
-    out.write<int16_t>(0);
-    out.write<int16_t>(0);
-    out.write<int16_t>(0);
-    out.write<int16_t>(0);
-
-    out.write<uint16_t>(num_long_ver_metrics);
+    write_record(out, layout, *this);
 }
 
 bool VheaTable::operator==(const OTFTable& rhs) const noexcept
@@ -1,5 +1,7 @@
 #include "vmtxtable.hpp"
 
+#include "../checksum.hpp"
+
 #include <cassert>
 
 namespace geul
@@ -9,22 +11,16 @@ VmtxTable::VmtxTable(std::size_t num_glyphs, std::size_t num_v_metrics)
     , advance_height(num_glyphs - num_v_metrics)
 {}
 
-void VmtxTable::parse(InputBuffer& dis)
+void VmtxTable::parse(BufferView& dis)
 {
     advance_height = dis.read<uint16_t>();
-    for (auto& tsb : top_side_bearings)
-    {
-        tsb = dis.read<int16_t>();
-    }
+    dis.read<int16_t>(top_side_bearings.data(), top_side_bearings.size());
 }
 
 void VmtxTable::compile(OutputBuffer& out) const
 {
     out.write<uint16_t>(advance_height);
-    for (auto tsb : top_side_bearings)
-    {
-        out.write<int16_t>(tsb);
-    }
+    out.write<int16_t>(top_side_bearings.data(), top_side_bearings.size());
 }
 
 bool VmtxTable::operator==(const OTFTable& rhs) const noexcept
@@ -35,4 +31,11 @@ bool VmtxTable::operator==(const OTFTable& rhs) const noexcept
     return advance_height == other.advance_height
            && top_side_bearings == other.top_side_bearings;
 }
+
+uint64_t VmtxTable::calculate_hash() const
+{
+    return content_hash(
+        reinterpret_cast<char const*>(top_side_bearings.data()),
+        top_side_bearings.size() * sizeof(int16_t), advance_height);
+}
 }
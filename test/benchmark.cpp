@@ -0,0 +1,467 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+#include "fontutils/checksum.hpp"
+#include "fontutils/csparser.hpp"
+#include "fontutils/endian.hpp"
+#include "fontutils/otfparser.hpp"
+#include "fontutils/tables/cfftable.hpp"
+
+namespace
+{
+constexpr auto font_file = "data/NotoSansCJKkr-Regular.otf";
+
+// Parse a whole font through the std::filebuf backed buffer
+void parse_otf_filebuf(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        geul::Font font;
+        auto       buf = geul::InputBuffer::open(font_file);
+        auto       view = buf.view();
+        font.parse(view);
+        font.parse_tables(view);
+        benchmark::DoNotOptimize(font);
+    }
+}
+BENCHMARK(parse_otf_filebuf)->Unit(benchmark::kMillisecond);
+
+// Parse a whole font through the memory-mapped buffer
+void parse_otf_mmap(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        geul::Font font;
+        auto       buf = geul::InputBuffer::map(font_file);
+        auto       view = buf.view();
+        font.parse(view);
+        font.parse_tables(view);
+        benchmark::DoNotOptimize(font);
+    }
+}
+BENCHMARK(parse_otf_mmap)->Unit(benchmark::kMillisecond);
+
+// Parse the tables of a whole font on state.range(0) threads
+void parse_otf_parallel(benchmark::State& state)
+{
+    auto buf = geul::InputBuffer::map(font_file);
+    for (auto _ : state)
+    {
+        geul::Font font;
+        auto       view = buf.view();
+        font.parse(view);
+        font.parse_tables(buf.view(), state.range(0));
+        benchmark::DoNotOptimize(font);
+    }
+}
+BENCHMARK(parse_otf_parallel)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Read the font name only, leaving the other tables unparsed
+void parse_otf_lazy(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        auto font = geul::parse_otf(font_file);
+        benchmark::DoNotOptimize(font.table("name"));
+    }
+}
+BENCHMARK(parse_otf_lazy)->Unit(benchmark::kMillisecond);
+
+// Read the table directory with each way of handling checksums
+void parse_otf_checksums(
+    benchmark::State& state, geul::ParseOptions::Checksums checksums)
+{
+    geul::ParseOptions options;
+    options.checksums = checksums;
+    for (auto _ : state)
+    {
+        auto font = geul::parse_otf(font_file, options);
+        benchmark::DoNotOptimize(font);
+    }
+}
+BENCHMARK_CAPTURE(
+    parse_otf_checksums, verify, geul::ParseOptions::Checksums::verify)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(
+    parse_otf_checksums, skip, geul::ParseOptions::Checksums::skip)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(
+    parse_otf_checksums, deferred, geul::ParseOptions::Checksums::deferred)
+    ->Unit(benchmark::kMillisecond);
+
+// Parse every table vs. the metadata tables only
+void parse_otf_tables(benchmark::State& state, std::vector<std::string> tags)
+{
+    geul::ParseOptions options;
+    options.tables = tags;
+    auto buf = geul::InputBuffer::map(font_file);
+    for (auto _ : state)
+    {
+        geul::Font font;
+        auto       view = buf.view();
+        font.parse(view, options);
+        font.parse_tables(buf.view());
+        benchmark::DoNotOptimize(font);
+    }
+}
+BENCHMARK_CAPTURE(parse_otf_tables, all, std::vector<std::string>())
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(
+    parse_otf_tables, metadata, std::vector<std::string>{ "name", "OS/2" })
+    ->Unit(benchmark::kMillisecond);
+
+// Open a font and read the 14 basic consonants, as the editor does
+void load_jamo(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        auto font = geul::parse_otf(font_file);
+        for (char32_t ch = 0x3131; ch <= 0x3144; ++ch)
+            benchmark::DoNotOptimize(&font.glyph(ch));
+    }
+}
+BENCHMARK(load_jamo)->Unit(benchmark::kMillisecond);
+
+// Save a font after moving a point in a few of the jamo load_jamo reads.
+// The jamo that were only read are copied like the other glyphs.
+void save_jamo(benchmark::State& state)
+{
+    auto font = geul::parse_otf(font_file);
+    for (char32_t ch = 0x3131; ch <= 0x3144; ch += 4)
+    {
+        auto& glyph = font.glyph(ch);
+        if (!glyph.paths.empty())
+            glyph.paths[0].start.x += 1;
+    }
+    for (char32_t ch = 0x3131; ch <= 0x3144; ++ch)
+        font.glyph(ch);
+
+    std::size_t size = 0;
+    for (auto _ : state)
+    {
+        geul::OutputBuffer out;
+        font.compile(out);
+        size = out.size();
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(save_jamo)->Unit(benchmark::kMillisecond);
+
+// Decode every glyph of the CFF table on state.range(0) threads
+void decode_glyphs(benchmark::State& state)
+{
+    auto font = geul::parse_otf(font_file);
+    auto cff = font.table<geul::CFFTable>();
+    auto const& glyphs = cff->fonts[0].glyphs;
+    for (auto _ : state)
+    {
+        auto decoded = glyphs;
+        decoded.decode_all(state.range(0));
+        benchmark::DoNotOptimize(decoded);
+    }
+    state.SetItemsProcessed(state.iterations() * glyphs.size());
+}
+BENCHMARK(decode_glyphs)
+    ->RangeMultiplier(2)
+    ->Range(1, 32)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Decode the charstring of every glyph straight from the table bytes.
+// Reports glyphs per second.
+void parse_charstrings(benchmark::State& state)
+{
+    auto font = geul::parse_otf(font_file);
+    auto cff = font.table<geul::CFFTable>();
+    auto const& source = *cff->fonts[0].glyphs.source();
+    for (auto _ : state)
+    {
+        for (auto gid = 0u; gid < source.charstrings.size(); ++gid)
+        {
+            auto fd = source.fd_select[gid];
+            auto glyph = geul::parse_charstring(
+                source.charstrings[gid],
+                source.gsubrs,
+                source.lsubrs[fd],
+                source.default_width_x[fd],
+                source.nominal_width_x[fd]);
+            benchmark::DoNotOptimize(glyph);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * source.charstrings.size());
+}
+BENCHMARK(parse_charstrings)->Unit(benchmark::kMillisecond);
+
+// Encode every glyph of `file` with the operators that take the fewest
+// bytes. Reports the size of the charstrings, and how many times smaller
+// they are than with one rmoveto, rlineto or rrcurveto per segment.
+void encode_charstrings(benchmark::State& state, char const* file)
+{
+    auto font = geul::parse_otf(file);
+    auto cff = font.table<geul::CFFTable>();
+    auto& glyphs = cff->fonts[0].glyphs;
+    glyphs.decode_all();
+
+    std::size_t size = 0;
+    for (auto _ : state)
+    {
+        geul::OutputBuffer out;
+        for (auto gid = 0u; gid < glyphs.size(); ++gid)
+            geul::write_charstring(out, *glyphs.get(gid));
+        size = out.size();
+        benchmark::DoNotOptimize(out);
+    }
+
+    auto number_size = [](int v) {
+        return v >= -107 && v <= 107 ? 1 : v >= -1131 && v <= 1131 ? 2 : 3;
+    };
+    std::size_t plain = 0;
+    for (auto gid = 0u; gid < glyphs.size(); ++gid)
+    {
+        geul::Point pos = { 0, 0 };
+        auto        to = [&](geul::Point p) {
+            auto size = number_size(p.x - pos.x) + number_size(p.y - pos.y);
+            pos = p;
+            return size;
+        };
+        for (auto const& path : glyphs.get(gid)->paths)
+        {
+            plain += to(path.start) + 1;
+            for (auto const& seg : path.segments)
+            {
+                if (!(seg.ct1 == seg.p && seg.ct2 == seg.p))
+                    plain += to(seg.ct1) + to(seg.ct2);
+                plain += to(seg.p) + 1;
+            }
+        }
+        plain += 1;
+    }
+
+    state.counters["bytes"] = size;
+    state.counters["ratio"] = double(plain) / size;
+    state.SetItemsProcessed(state.iterations() * glyphs.size());
+}
+BENCHMARK_CAPTURE(encode_charstrings, noto, "data/NotoSansCJKkr-Regular.otf")
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(
+    encode_charstrings, source_han, "data/SourceHanSansKR-Regular.otf")
+    ->Unit(benchmark::kMillisecond);
+
+// Compile a parsed font (65535 glyphs) into memory
+void compile_otf(benchmark::State& state)
+{
+    geul::Font font;
+    auto       buf = geul::InputBuffer::map(font_file);
+    auto       view = buf.view();
+    font.parse(view);
+    font.parse_tables(view);
+    std::size_t size = 0;
+    for (auto _ : state)
+    {
+        geul::OutputBuffer out;
+        font.compile(out);
+        size = out.size();
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(compile_otf)->Unit(benchmark::kMillisecond);
+
+// Compile the tables of a parsed font on state.range(0) threads
+void compile_otf_parallel(benchmark::State& state)
+{
+    geul::Font font;
+    auto       buf = geul::InputBuffer::map(font_file);
+    auto       view = buf.view();
+    font.parse(view);
+    font.parse_tables(buf.view());
+    for (auto _ : state)
+    {
+        geul::OutputBuffer out;
+        font.compile(out, state.range(0));
+        benchmark::DoNotOptimize(out);
+    }
+}
+BENCHMARK(compile_otf_parallel)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Compile the CFF table with all glyphs encoded on state.range(1) threads,
+// subroutinizing or not as state.range(0) says. Reports the size of the
+// table.
+void compile_cff(benchmark::State& state)
+{
+    auto font = geul::parse_otf(font_file);
+    auto cff = font.table<geul::CFFTable>();
+    cff->keep_charstrings = false;
+    cff->subroutinize = state.range(0);
+    cff->num_threads = state.range(1);
+    std::size_t size = 0;
+    for (auto _ : state)
+    {
+        geul::OutputBuffer out;
+        cff->compile(out);
+        size = out.size();
+        benchmark::DoNotOptimize(out);
+    }
+    state.counters["bytes"] = size;
+}
+BENCHMARK(compile_cff)
+    ->Args({ 0, 1 })
+    ->Args({ 0, 2 })
+    ->Args({ 0, 4 })
+    ->Args({ 1, 1 })
+    ->Args({ 1, 2 })
+    ->Args({ 1, 4 })
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Look up the glyphs of all Hangul syllables
+void glyph_lookup(benchmark::State& state)
+{
+    auto font = geul::parse_otf(font_file);
+    font.glyph(U'\uAC00');
+    for (auto _ : state)
+    {
+        for (char32_t ch = 0xAC00; ch <= 0xD7A3; ++ch)
+            benchmark::DoNotOptimize(&font.glyph(ch));
+    }
+    state.SetItemsProcessed(state.iterations() * (0xD7A3 - 0xAC00 + 1));
+}
+BENCHMARK(glyph_lookup)->Unit(benchmark::kMicrosecond);
+
+// Compare a font to a round-trip copy, with one glyph changed or not.
+// Hashes are computed by the first comparison and reused afterwards.
+void compare_otf(benchmark::State& state)
+{
+    auto font = geul::parse_otf(font_file);
+    font.table("CFF ");
+    geul::OutputBuffer out;
+    font.compile(out);
+    auto       view = out.view();
+    geul::Font copy;
+    copy.parse(view);
+    copy.table("CFF ");
+    if (state.range(0))
+        copy.glyph(U'\uAC00').paths[0].start.x += 1;
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(font == copy);
+}
+BENCHMARK(compare_otf)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Read the whole file 2 bytes at a time
+void read_uint16(benchmark::State& state, geul::InputBuffer (*open)(std::string))
+{
+    for (auto _ : state)
+    {
+        auto     buf = open(font_file);
+        auto     n = buf.size() / 2;
+        uint16_t sum = 0;
+        for (auto i = 0u; i < n; ++i)
+            sum += buf.read<uint16_t>();
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK_CAPTURE(read_uint16, filebuf, geul::InputBuffer::open)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(read_uint16, mmap, geul::InputBuffer::map)
+    ->Unit(benchmark::kMillisecond);
+
+// Table checksum over 20 MB, one word at a time vs. the vector kernel
+void checksum_words(benchmark::State& state)
+{
+    std::vector<char> bytes(20 << 20, 0x5a);
+    for (auto _ : state)
+    {
+        geul::BufferView view(bytes.data(), bytes.size());
+        uint32_t         sum = 0;
+        for (auto i = 0u; i < bytes.size() / 4; ++i)
+            sum += view.read<uint32_t>();
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(checksum_words)->Unit(benchmark::kMillisecond);
+
+void checksum_kernel(benchmark::State& state)
+{
+    std::vector<char> bytes(20 << 20, 0x5a);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(geul::checksum(bytes.data(), bytes.size()));
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(checksum_kernel)->Unit(benchmark::kMillisecond);
+
+// Big-endian array decoding, one item at a time vs. in bulk
+template <typename T> void decode_scalar(benchmark::State& state)
+{
+    std::vector<char> bytes(state.range(0) * sizeof(T), 0x5a);
+    std::vector<T>    items(state.range(0));
+    for (auto _ : state)
+    {
+        for (auto i = 0u; i < items.size(); ++i)
+            items[i] = geul::to_machine_endian<T>(&bytes[i * sizeof(T)]);
+        benchmark::DoNotOptimize(items.data());
+    }
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK_TEMPLATE(decode_scalar, uint16_t)->Arg(65536);
+BENCHMARK_TEMPLATE(decode_scalar, uint32_t)->Arg(65536);
+
+template <typename T> void decode_bulk(benchmark::State& state)
+{
+    std::vector<char> bytes(state.range(0) * sizeof(T), 0x5a);
+    std::vector<T>    items(state.range(0));
+    for (auto _ : state)
+    {
+        geul::to_machine_endian<T>(bytes.data(), items.data(), items.size());
+        benchmark::DoNotOptimize(items.data());
+    }
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK_TEMPLATE(decode_bulk, uint16_t)->Arg(65536);
+BENCHMARK_TEMPLATE(decode_bulk, uint32_t)->Arg(65536);
+
+// Big-endian array encoding, one item at a time vs. in bulk
+template <typename T> void encode_scalar(benchmark::State& state)
+{
+    std::vector<T>    items(state.range(0), T(0x5a5a));
+    std::vector<char> bytes(state.range(0) * sizeof(T));
+    for (auto _ : state)
+    {
+        for (auto i = 0u; i < items.size(); ++i)
+            geul::to_big_endian<T>(&bytes[i * sizeof(T)], items[i]);
+        benchmark::DoNotOptimize(bytes.data());
+    }
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK_TEMPLATE(encode_scalar, uint16_t)->Arg(65536);
+BENCHMARK_TEMPLATE(encode_scalar, uint32_t)->Arg(65536);
+
+template <typename T> void encode_bulk(benchmark::State& state)
+{
+    std::vector<T>    items(state.range(0), T(0x5a5a));
+    std::vector<char> bytes(state.range(0) * sizeof(T));
+    for (auto _ : state)
+    {
+        geul::to_big_endian<T>(bytes.data(), items.data(), items.size());
+        benchmark::DoNotOptimize(bytes.data());
+    }
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK_TEMPLATE(encode_bulk, uint16_t)->Arg(65536);
+BENCHMARK_TEMPLATE(encode_bulk, uint32_t)->Arg(65536);
+}
+
+BENCHMARK_MAIN();
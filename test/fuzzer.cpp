@@ -2,15 +2,10 @@
 
 int main(int argc, char **argv) {
     if (argc == 2) {
-        geul::Font font;
-        try {
-            font = geul::parse_otf(argv[1]);
-        }
-        catch (std::exception const& e)
-        {
+        auto font = geul::try_parse_otf(argv[1]);
+        if (!font)
             return 0;
-        }
-        geul::write_otf(font, "out.otf");
+        geul::write_otf(*font, "out.otf");
     }
     return 0;
 }
@@ -3,10 +3,21 @@
 #include <chrono>
 #include <fstream>
 #include <gtest/gtest.h>
+#include <sstream>
 
 #include "fontutils/cffutils.hpp"
+#include "fontutils/checksum.hpp"
+#include "fontutils/csparser.hpp"
 #include "fontutils/endian.hpp"
 #include "fontutils/otfparser.hpp"
+#include "fontutils/parallel.hpp"
+#include "fontutils/subroutinizer.hpp"
+#include "fontutils/tables/cfftable.hpp"
+#include "fontutils/tables/cmaptable.hpp"
+#include "fontutils/tables/hmtxtable.hpp"
+#include "fontutils/tables/nametable.hpp"
+#include "fontutils/tables/os2table.hpp"
+#include "fontutils/tables/record.hpp"
 
 int main(int argc, char* argv[])
 {
@@ -88,16 +99,45 @@ TEST(geul, to_machine_endian_convert)
     }
 }
 
+TEST(geul, bulk_endian_convert)
+{
+    // cover both the vectorized body and the scalar tail
+    for (std::size_t count : { 1, 7, 8, 15, 16, 33, 1000 })
+    {
+        std::vector<char> bytes(count * 4);
+        for (auto i = 0u; i < bytes.size(); ++i)
+            bytes[i] = char(i * 37 + 11);
+
+        std::vector<uint16_t> u16(count * 2);
+        geul::to_machine_endian<uint16_t>(bytes.data(), u16.data(), u16.size());
+        for (auto i = 0u; i < u16.size(); ++i)
+            EXPECT_EQ(u16[i], geul::to_machine_endian<uint16_t>(&bytes[i * 2]));
+
+        std::vector<uint32_t> u32(count);
+        geul::to_machine_endian<uint32_t>(bytes.data(), u32.data(), u32.size());
+        for (auto i = 0u; i < u32.size(); ++i)
+            EXPECT_EQ(u32[i], geul::to_machine_endian<uint32_t>(&bytes[i * 4]));
+
+        std::vector<char> out16(bytes.size()), out32(bytes.size());
+        geul::to_big_endian<uint16_t>(out16.data(), u16.data(), u16.size());
+        geul::to_big_endian<uint32_t>(out32.data(), u32.data(), u32.size());
+        EXPECT_EQ(out16, bytes);
+        EXPECT_EQ(out32, bytes);
+    }
+}
+
 TEST(geul, token_writer)
 {
     geul::OutputBuffer buf1(""), buf2("");
     geul::write_token(buf1, -2.25);
-    auto t1 = geul::next_token(buf1);
+    auto in1 = buf1.view();
+    auto t1 = geul::next_token(in1);
     EXPECT_EQ(t1.get_type(), geul::CFFToken::Type::floating);
     EXPECT_DOUBLE_EQ(t1.to_double(), -2.25);
 
     geul::write_token(buf2, 0.140541E-3);
-    auto t2 = geul::next_token(buf2);
+    auto in2 = buf2.view();
+    auto t2 = geul::next_token(in2);
     EXPECT_EQ(t2.get_type(), geul::CFFToken::Type::floating);
     EXPECT_DOUBLE_EQ(t2.to_double(), 0.140541E-3);
 
@@ -105,7 +145,8 @@ TEST(geul, token_writer)
     {
         geul::OutputBuffer buf("");
         geul::write_token(buf, i);
-        auto t = geul::next_token(buf);
+        auto in = buf.view();
+        auto t = geul::next_token(in);
         EXPECT_EQ(t.get_type(), geul::CFFToken::Type::integer);
         EXPECT_DOUBLE_EQ(t.to_int(), i);
     }
@@ -113,7 +154,8 @@ TEST(geul, token_writer)
     {
         geul::OutputBuffer buf("");
         geul::write_token(buf, -12312312);
-        auto t = geul::next_token(buf);
+        auto in = buf.view();
+        auto t = geul::next_token(in);
         EXPECT_EQ(t.get_type(), geul::CFFToken::Type::integer);
         EXPECT_DOUBLE_EQ(t.to_int(), -12312312);
     }
@@ -121,12 +163,304 @@ TEST(geul, token_writer)
     {
         geul::OutputBuffer buf("");
         geul::write_token(buf, 12312312);
-        auto t = geul::next_token(buf);
+        auto in = buf.view();
+        auto t = geul::next_token(in);
         EXPECT_EQ(t.get_type(), geul::CFFToken::Type::integer);
         EXPECT_DOUBLE_EQ(t.to_int(), 12312312);
     }
 }
 
+TEST(geul, mapped_buffer)
+{
+    {
+        std::ofstream file("data/mapped_buffer.bin", std::ios::binary);
+        file.write("\x12\x34\x56\x78\x9a\xbc", 6);
+    }
+
+    auto buf = geul::InputBuffer::map("data/mapped_buffer.bin");
+    EXPECT_TRUE(buf.contiguous());
+    EXPECT_EQ(buf.size(), 6u);
+    EXPECT_EQ(buf.peek<uint16_t>(), 0x1234);
+    EXPECT_EQ(buf.read<uint32_t>(), 0x12345678u);
+
+    auto bytes = buf.read_shared(2);
+    EXPECT_EQ(bytes.span().str(), "\x9a\xbc");
+    EXPECT_ANY_THROW(buf.read<uint8_t>());
+
+    buf.seek(2);
+    EXPECT_EQ(buf.read_span(2).str(), "\x56\x78");
+    EXPECT_EQ(buf.tell(), 4);
+
+    // views share the mapping, and outlive the buffer
+    geul::BufferView view;
+    {
+        auto mapped = geul::InputBuffer::map("data/mapped_buffer.bin");
+        view = mapped.view();
+    }
+    view.seek(2);
+    EXPECT_EQ(view.read<uint32_t>(), 0x56789abcu);
+    view.seek(0);
+    EXPECT_EQ(view.read_shared(2).span().str(), "\x12\x34");
+}
+
+TEST(geul, buffer_view)
+{
+    geul::InputBuffer buf(std::string("\x00\x02\x12\x34\x56\x78", 6));
+    buf.seek(2);
+
+    auto view = buf.view();
+    EXPECT_EQ(view.tell(), 2u);
+    EXPECT_EQ(view.size(), 6u);
+    EXPECT_EQ(view.read_at<uint16_t>(0), 2);
+
+    // copies read independently
+    auto inner = view.at(view.read_at<uint16_t>(0) + 2);
+    EXPECT_EQ(inner.read<uint16_t>(), 0x5678);
+    EXPECT_EQ(view.read<uint16_t>(), 0x1234);
+    EXPECT_EQ(view.tell(), 4u);
+    EXPECT_ANY_THROW(inner.read<uint8_t>());
+
+    auto slice = view.slice(2, 2);
+    EXPECT_EQ(slice.size(), 2u);
+    EXPECT_EQ(slice.read_shared(2).span().str(), "\x12\x34");
+    EXPECT_ANY_THROW(view.slice(4, 3));
+}
+
+TEST(geul, output_buffer)
+{
+    geul::OutputBuffer buf;
+    buf.write<uint16_t>(0x1234);
+    buf.write_zeros(4);
+    buf.write<uint8_t>(0x56);
+    buf.write_at<uint32_t>(2, 0x89abcdef);
+    EXPECT_EQ(buf.tell(), 7u);
+    EXPECT_ANY_THROW(buf.write_at<uint32_t>(4, 0));
+
+    buf.pad();
+    EXPECT_EQ(buf.size(), 8u);
+    EXPECT_EQ(buf.tell(), 7u);
+    EXPECT_EQ(
+        buf.view().span().str(),
+        std::string("\x12\x34\x89\xab\xcd\xef\x56\x00", 8));
+
+    // overwrite in the middle, then append at the end
+    buf.seek(1);
+    buf.write<uint8_t>(0xff);
+    buf.seek_end();
+    buf.write_nint(3, 0x010203);
+    EXPECT_EQ(buf.size(), 11u);
+    EXPECT_EQ(buf.view().read_at<uint16_t>(0), 0x12ff);
+    EXPECT_EQ(buf.view().read_at<uint32_t>(7), 0x00010203u);
+}
+
+TEST(geul, checksum)
+{
+    std::vector<char> bytes(1027);
+    for (auto i = 0u; i < bytes.size(); ++i)
+        bytes[i] = char(i * 37 + (i >> 3));
+
+    auto reference = [&](std::size_t begin, std::size_t length) {
+        uint32_t sum = 0;
+        for (auto i = 0u; i < length; ++i)
+            sum += uint32_t(uint8_t(bytes[begin + i])) << (8 * (3 - i % 4));
+        return sum;
+    };
+
+    for (auto length : { 0u, 1u, 3u, 4u, 31u, 64u, 1000u, 1027u })
+    {
+        EXPECT_EQ(geul::checksum(bytes.data(), length), reference(0, length));
+
+        // summed in two pieces
+        auto half = length / 2 + 1;
+        if (half < length)
+        {
+            EXPECT_EQ(
+                geul::checksum(bytes.data(), half)
+                    + geul::checksum(bytes.data() + half, length - half, half),
+                reference(0, length));
+        }
+    }
+
+    // running checksum follows appends, overwrites and patches
+    geul::OutputBuffer buf;
+    buf.write<uint16_t>(0xabcd);
+    buf.begin_checksum();
+    buf.write<char>(bytes.data(), 101);
+    buf.write_at<uint32_t>(50, 0x12345678);
+    buf.write_at<uint16_t>(0, 0x1111);
+    buf.seek(10);
+    buf.write_nint(3, 0xffeedd);
+    buf.seek_end();
+    buf.write_zeros(5);
+    buf.pad();
+    auto view = buf.view();
+    EXPECT_EQ(
+        buf.end_checksum(), geul::checksum(view.span().data + 2, buf.size() - 2));
+}
+
+namespace
+{
+struct TestRecord
+{
+    struct Inner
+    {
+        uint8_t a, b;
+    };
+
+    uint16_t               x;
+    std::size_t            y;
+    Inner                  inner;
+    std::array<uint8_t, 4> tag;
+};
+}
+
+TEST(geul, record_layout)
+{
+    constexpr auto layout = geul::record_layout(
+        geul::constant<uint16_t>(1, "bad version"),
+        geul::field(&TestRecord::x),
+        geul::reserved<uint16_t>(),
+        geul::field<uint32_t>(&TestRecord::y),
+        geul::nested(
+            &TestRecord::inner,
+            geul::record_layout(
+                geul::field(&TestRecord::Inner::a),
+                geul::field(&TestRecord::Inner::b))),
+        geul::field(&TestRecord::tag));
+    static_assert(decltype(layout)::size == 16, "record size");
+
+    std::string bytes("\x00\x01\x12\x34\xff\xff\x00\x01\x00\x02\x05\x06"
+                      "abcd",
+                      16);
+    geul::BufferView view(bytes.data(), bytes.size());
+    TestRecord       record;
+    geul::read_record(view, layout, record);
+    EXPECT_EQ(view.tell(), 16u);
+    EXPECT_EQ(record.x, 0x1234);
+    EXPECT_EQ(record.y, 0x10002u);
+    EXPECT_EQ(record.inner.a, 5);
+    EXPECT_EQ(record.inner.b, 6);
+    EXPECT_EQ(record.tag, (std::array<uint8_t, 4>{ 'a', 'b', 'c', 'd' }));
+
+    // reserved fields are written as zero
+    geul::OutputBuffer out;
+    geul::write_record(out, layout, record);
+    bytes[4] = bytes[5] = 0;
+    EXPECT_EQ(out.view().span().str(), bytes);
+
+    bytes[1] = 2;
+    geul::BufferView bad(bytes.data(), bytes.size());
+    EXPECT_THROW(geul::read_record(bad, layout, record), std::runtime_error);
+    geul::BufferView short_view(bytes.data(), 15);
+    EXPECT_ANY_THROW(geul::read_record(short_view, layout, record));
+}
+
+TEST(geul, parse_error)
+{
+    std::string bytes("\x00\x01\x00\x02\x00\x03", 6);
+
+    geul::ParseError error;
+    auto view = geul::BufferView(bytes.data(), bytes.size()).report_to(&error);
+    auto slice = view.slice(2, 4);
+    EXPECT_EQ(slice.read<uint32_t>(), 0x00020003u);
+    EXPECT_FALSE(view.failed());
+
+    // failed reads return zeros and move to the end
+    slice.seek(2);
+    EXPECT_EQ(slice.read<uint32_t>(), 0u);
+    EXPECT_EQ(slice.tell(), 4u);
+    EXPECT_TRUE(view.failed());
+    EXPECT_EQ(error.code, geul::ParseError::Code::out_of_bounds);
+    EXPECT_EQ(error.offset, 4u);
+
+    // the first error is kept
+    view.fail(geul::ParseError::Code::bad_value, "second");
+    EXPECT_EQ(error.code, geul::ParseError::Code::out_of_bounds);
+
+    auto font = geul::InputBuffer::map("data/NotoSansCJKkr-Regular.otf");
+    auto span = font.view().span();
+    std::string data(span.data, span.size);
+    EXPECT_TRUE(geul::try_parse_otf(span));
+
+    data[0] = 'X';
+    auto result = geul::try_parse_otf(geul::ByteSpan{ data.data(), 64 });
+    ASSERT_FALSE(result);
+    EXPECT_EQ(result.error().code, geul::ParseError::Code::unsupported);
+    EXPECT_EQ(result.error().offset, 4u);
+    EXPECT_THROW(result.value(), std::runtime_error);
+
+    // corrupt the first table
+    data[0] = span.data[0];
+    std::size_t offset = geul::BufferView(span).read_at<uint32_t>(12 + 8);
+    data[offset + 1] ^= 1;
+    result = geul::try_parse_otf(geul::ByteSpan{ data.data(), data.size() });
+    ASSERT_FALSE(result);
+    EXPECT_EQ(result.error().code, geul::ParseError::Code::bad_checksum);
+    EXPECT_EQ(result.error().tag, data.substr(12, 4));
+    EXPECT_EQ(result.error().offset, 12u);
+
+    result = geul::try_parse_otf(geul::ByteSpan{ data.data(), offset });
+    ASSERT_FALSE(result);
+    EXPECT_EQ(result.error().code, geul::ParseError::Code::out_of_bounds);
+}
+
+namespace
+{
+// Parse a font file and all of its tables, marked as modified
+// so that they are compiled again
+geul::Font parse_all(std::string const& filename)
+{
+    geul::Font font;
+    auto       buf = geul::InputBuffer::map(filename);
+    auto       view = buf.view();
+    font.parse(view);
+    font.parse_tables(view);
+    for (auto const& tag : font.tags())
+        font.table(tag);
+    return font;
+}
+
+// Bytes of the table `tag` in a compiled font
+geul::BufferView
+    table_bytes(geul::BufferView const& dis, std::string const& tag)
+{
+    auto num_tables = dis.read_at<uint16_t>(4);
+    for (auto i = 0u; i < num_tables; ++i)
+    {
+        auto record = 12 + 16 * i;
+        if (dis.slice(record, 4).span().str() == tag)
+        {
+            return dis.slice(
+                dis.read_at<uint32_t>(record + 8),
+                dis.read_at<uint32_t>(record + 12));
+        }
+    }
+    return geul::BufferView();
+}
+}
+
+TEST(geul, stream_compile)
+{
+    auto font = parse_all("data/NotoSansCJKkr-Regular.otf");
+
+    geul::OutputBuffer buf;
+    font.compile(buf);
+
+    // strictly in order, to a stream that is never sought
+    std::ostringstream os;
+    geul::write_otf(font, os);
+    EXPECT_EQ(os.str(), buf.view().span().str());
+
+    // with the unmodified tables copied from their bytes
+    auto lazy = geul::parse_otf("data/NotoSansCJKkr-Regular.otf");
+    lazy.glyph(U'\uAC00').width += 1;
+    buf = geul::OutputBuffer();
+    lazy.compile(buf);
+    os.str("");
+    geul::write_otf(lazy, os);
+    EXPECT_EQ(os.str(), buf.view().span().str());
+}
+
 TEST(write_font, geul)
 {
     auto files = {
@@ -135,7 +469,7 @@ TEST(write_font, geul)
     };
     for (auto open : files)
     {
-        auto font = geul::parse_otf(open);
+        auto font = parse_all(open);
         std::cout << "OTF file Succesfully parsed.\n" << std::endl;
 
         geul::write_otf(font, "data/testout.otf");
@@ -146,6 +480,810 @@ TEST(write_font, geul)
     }
 }
 
+TEST(geul, lazy_tables)
+{
+    auto file = "data/NotoSansCJKkr-Regular.otf";
+    auto font = geul::parse_otf(file);
+    EXPECT_FALSE(font.parsed("CFF "));
+    EXPECT_EQ(font.table("ABCD"), nullptr);
+
+    // 'hmtx' pulls in the tables it depends on
+    ASSERT_NE(font.table("hmtx"), nullptr);
+    EXPECT_TRUE(font.parsed("hmtx"));
+    EXPECT_TRUE(font.parsed("maxp"));
+    EXPECT_TRUE(font.parsed("hhea"));
+    EXPECT_FALSE(font.parsed("CFF "));
+
+    // untouched tables are written back as they were
+    geul::OutputBuffer out;
+    font.compile(out);
+    auto input = geul::InputBuffer::map(file);
+    auto in = input.view();
+    auto compiled = out.view();
+    EXPECT_TRUE(
+        table_bytes(compiled, "CFF ").span() == table_bytes(in, "CFF ").span());
+    EXPECT_TRUE(
+        table_bytes(compiled, "cmap").span() == table_bytes(in, "cmap").span());
+    EXPECT_FALSE(font.parsed("CFF "));
+
+    auto all = parse_all(file);
+    EXPECT_EQ(font, all);
+    EXPECT_TRUE(font.parsed("CFF "));
+
+    // readers of a const font on several threads parse each table once
+    auto const                         shared = geul::parse_otf(file);
+    std::vector<geul::OTFTable const*> read(16);
+    std::vector<uint64_t>              hashes(read.size());
+    geul::parallel_for(read.size(), 4, [&](std::size_t i) {
+        auto cff = shared.table<geul::CFFTable>();
+        read[i] = cff;
+        hashes[i] = cff->fonts[0].glyphs.hash(i % 4);
+        shared.table<geul::HmtxTable>();
+    });
+    for (auto i = 0u; i < read.size(); ++i)
+    {
+        EXPECT_EQ(read[i], read[0]);
+        EXPECT_EQ(hashes[i], hashes[i % 4]);
+    }
+    EXPECT_TRUE(shared.parsed("hmtx"));
+}
+
+TEST(geul, parallel_parse)
+{
+    auto file = "data/NotoSansCJKkr-Regular.otf";
+    auto buf = geul::InputBuffer::map(file);
+    auto view = buf.view();
+
+    geul::Font serial;
+    auto       dis = view;
+    serial.parse(dis);
+    serial.parse_tables(view);
+
+    geul::Font parallel;
+    dis = view;
+    parallel.parse(dis);
+    parallel.parse_tables(view, 4);
+    EXPECT_TRUE(parallel.parsed("CFF "));
+    EXPECT_TRUE(parallel.parsed("vmtx"));
+
+    // compare the parsed tables rather than their bytes
+    for (auto const& tag : serial.tags())
+    {
+        serial.table(tag);
+        parallel.table(tag);
+    }
+    EXPECT_EQ(serial, parallel);
+
+    // a broken dependency stops 'hmtx' with the same error
+    auto span = view.span();
+    std::string data(span.data, span.size);
+    auto num_tables = view.read_at<uint16_t>(4);
+    for (auto i = 0u; i < num_tables; ++i)
+    {
+        auto record = 12 + 16 * i;
+        if (data.substr(record, 4) == "maxp")
+        {
+            // numGlyphs
+            auto offset = view.read_at<uint32_t>(record + 8);
+            data[offset + 4] = 0;
+            data[offset + 5] = 1;
+        }
+    }
+
+    // tables come from the broken copy, the directory from the original
+    geul::BufferView broken(geul::ByteSpan{ data.data(), data.size() });
+    geul::ParseError errors[2];
+    for (auto threads : { 1u, 4u })
+    {
+        geul::Font font;
+        dis = view;
+        font.parse(dis);
+        font.parse_tables(broken.report_to(&errors[threads / 4]), threads);
+    }
+    EXPECT_EQ(errors[0].code, geul::ParseError::Code::bad_value);
+    EXPECT_EQ(errors[0].tag, "hmtx");
+    EXPECT_EQ(errors[1].code, errors[0].code);
+    EXPECT_EQ(errors[1].tag, errors[0].tag);
+    EXPECT_EQ(errors[1].offset, errors[0].offset);
+}
+
+TEST(geul, parallel_compile)
+{
+    auto font = parse_all("data/SourceHanSansKR-Regular.otf");
+
+    geul::OutputBuffer serial;
+    font.compile(serial);
+
+    geul::OutputBuffer parallel;
+    font.compile(parallel, 4);
+    EXPECT_EQ(parallel.view().span().str(), serial.view().span().str());
+
+    // tables never parsed are laid out the same way
+    auto lazy = geul::parse_otf("data/SourceHanSansKR-Regular.otf");
+    lazy.table("name");
+    serial = geul::OutputBuffer();
+    lazy.compile(serial);
+    parallel = geul::OutputBuffer();
+    lazy.compile(parallel, 4);
+    EXPECT_EQ(parallel.view().span().str(), serial.view().span().str());
+}
+
+TEST(geul, passthrough)
+{
+    auto file = "data/NotoSansCJKkr-Regular.otf";
+    auto font = geul::parse_otf(file);
+
+    geul::OutputBuffer untouched;
+    font.compile(untouched);
+
+    // reading does not modify
+    auto const& reading = font;
+    ASSERT_NE(reading.table("CFF "), nullptr);
+    EXPECT_TRUE(font.parsed("CFF "));
+    EXPECT_FALSE(font.modified("CFF "));
+
+    geul::OutputBuffer clean;
+    font.compile(clean);
+    EXPECT_EQ(clean.view().span().str(), untouched.view().span().str());
+
+    // only the modified table is compiled again
+    ASSERT_NE(font.table("name"), nullptr);
+    EXPECT_TRUE(font.modified("name"));
+    EXPECT_FALSE(font.modified("CFF "));
+
+    geul::OutputBuffer out;
+    font.compile(out);
+    auto               recompiled = parse_all(file);
+    geul::OutputBuffer expected;
+    recompiled.compile(expected);
+    auto input = geul::InputBuffer::map(file);
+    EXPECT_TRUE(
+        table_bytes(out.view(), "name").span()
+        == table_bytes(expected.view(), "name").span());
+    EXPECT_TRUE(
+        table_bytes(out.view(), "CFF ").span()
+        == table_bytes(input.view(), "CFF ").span());
+}
+
+TEST(geul, parse_options)
+{
+    using Checksums = geul::ParseOptions::Checksums;
+
+    auto file = geul::InputBuffer::map("data/NotoSansCJKkr-Regular.otf");
+    auto span = file.view().span();
+    std::string data(span.data, span.size);
+    geul::ByteSpan bytes{ data.data(), data.size() };
+
+    // a string in 'name' no longer matches its checksum
+    geul::BufferView view(span);
+    auto             num_tables = view.read_at<uint16_t>(4);
+    std::size_t      vorg = 0;
+    for (auto i = 0u; i < num_tables; ++i)
+    {
+        auto record = 12 + 16 * i;
+        if (data.substr(record, 4) == "name")
+        {
+            auto end = view.read_at<uint32_t>(record + 8)
+                       + view.read_at<uint32_t>(record + 12);
+            data[end - 1] ^= 1;
+        }
+        if (data.substr(record, 4) == "VORG")
+            vorg = record;
+    }
+
+    geul::ParseOptions options;
+    EXPECT_FALSE(geul::try_parse_otf(bytes, options));
+    options.checksums = Checksums::skip;
+    EXPECT_TRUE(geul::try_parse_otf(bytes, options));
+
+    options.checksums = Checksums::deferred;
+    auto result = geul::try_parse_otf(bytes, options);
+    ASSERT_TRUE(result);
+    auto error = result->verify_checksums();
+    EXPECT_EQ(error.code, geul::ParseError::Code::bad_checksum);
+    EXPECT_EQ(error.tag, "name");
+
+    // only the listed tables and their dependencies are read, and the
+    // others are written back as they were
+    options.tables = { "hmtx", "OS/2" };
+    result = geul::try_parse_otf(bytes, options);
+    ASSERT_TRUE(result);
+    for (auto tag : { "OS/2", "hhea", "hmtx", "maxp" })
+        EXPECT_TRUE(result->parsed(tag));
+    EXPECT_FALSE(result->parsed("name"));
+    EXPECT_EQ(result->table("CFF "), nullptr);
+    EXPECT_FALSE(result->verify_checksums());
+
+    auto all_options = options;
+    all_options.tables.clear();
+    all_options.checksums = Checksums::skip;
+    auto all = geul::try_parse_otf(bytes, all_options);
+    ASSERT_TRUE(all);
+    EXPECT_EQ(result->tags(), all->tags());
+    geul::OutputBuffer listed_out, all_out;
+    result->compile(listed_out);
+    all->compile(all_out);
+    EXPECT_EQ(listed_out.view().span().str(), all_out.view().span().str());
+    EXPECT_TRUE(*result == *all);
+
+    // without 'VORG'
+    options.tables.clear();
+    data[vorg + 3] = 'X';
+    result = geul::try_parse_otf(bytes, options);
+    ASSERT_FALSE(result);
+    EXPECT_EQ(result.error().code, geul::ParseError::Code::missing_table);
+    options.require_tables = false;
+    EXPECT_TRUE(geul::try_parse_otf(bytes, options));
+}
+
+TEST(geul, typed_tables)
+{
+    static_assert(geul::pack_tag("CFF ") == 0x43464620, "");
+    EXPECT_EQ(geul::pack_tag(std::string("cmap")), geul::pack_tag("cmap"));
+    EXPECT_EQ(geul::pack_tag(std::string("cma")), 0u);
+    EXPECT_EQ(geul::unpack_tag(0x4F532F32), "OS/2");
+
+    auto        font = geul::parse_otf("data/NotoSansCJKkr-Regular.otf");
+    auto const& reading = font;
+    auto        cmap = reading.table<geul::CmapTable>();
+    ASSERT_NE(cmap, nullptr);
+    EXPECT_EQ(cmap, reading.table("cmap"));
+    EXPECT_FALSE(font.modified("cmap"));
+
+    auto cff = font.table<geul::CFFTable>();
+    ASSERT_NE(cff, nullptr);
+    EXPECT_TRUE(font.modified("CFF "));
+
+    // glyph() modifies 'CFF ' only
+    auto& glyph = font.glyph(U'\uAC00');
+    EXPECT_EQ(&glyph, &cff->fonts[0].glyphs.at(cmap->gid(U'\uAC00')));
+    EXPECT_FALSE(font.modified("cmap"));
+}
+
+TEST(geul, font_collection)
+{
+    auto noto = "data/NotoSansCJKkr-Regular.otf";
+    auto source = "data/SourceHanSansKR-Regular.otf";
+
+    geul::FontCollection collection;
+    collection.fonts.push_back(geul::parse_otf(noto));
+    collection.fonts.push_back(geul::parse_otf(source));
+    collection.fonts.push_back(geul::parse_otf(noto));
+
+    geul::FontCollection pair;
+    pair.fonts.push_back(geul::parse_otf(noto));
+    pair.fonts.push_back(geul::parse_otf(source));
+    geul::OutputBuffer pair_out;
+    pair.compile(pair_out);
+
+    // the repeated font adds only its offset and its offset table
+    geul::OutputBuffer out;
+    collection.compile(out);
+    auto num_tables = collection.fonts[0].tags().size();
+    EXPECT_EQ(out.size(), pair_out.size() + 4 + 12 + 16 * num_tables);
+
+    geul::FontCollection parsed;
+    auto                 view = out.view();
+    parsed.parse(view);
+    ASSERT_EQ(parsed.fonts.size(), 3u);
+    EXPECT_EQ(parsed, collection);
+
+    // members parse shared tables into tables of their own
+    auto cff0 = parsed.fonts[0].table("CFF ");
+    auto cff2 = parsed.fonts[2].table("CFF ");
+    EXPECT_NE(cff0, cff2);
+    EXPECT_TRUE(*cff0 == *cff2);
+
+    // a member's table checksum is still verified
+    std::string bytes = view.span().str();
+    bytes[bytes.size() / 2] ^= 1;
+    geul::ParseError error;
+    auto dis = geul::BufferView(geul::ByteSpan{ bytes.data(), bytes.size() })
+                   .report_to(&error);
+    parsed.parse(dis);
+    EXPECT_EQ(error.code, geul::ParseError::Code::bad_checksum);
+}
+
+TEST(geul, content_hash)
+{
+    auto file = "data/NotoSansCJKkr-Regular.otf";
+    auto font = parse_all(file);
+
+    geul::OutputBuffer out;
+    font.compile(out);
+    auto view = out.view();
+    geul::Font copy;
+    copy.parse(view);
+
+    // equal fonts hash alike, however their tables were read
+    EXPECT_EQ(font.hash(), copy.hash());
+    EXPECT_TRUE(font.diff(copy).empty());
+
+    auto gid = font.table<geul::CmapTable>()->gid(U'\uac00');
+    auto hash = font.hash();
+    auto glyph_hash = font.glyph(U'\uac00').hash();
+
+    // changing a glyph changes its hash and those of its table and font
+    font.glyph(U'\uac00').paths[0].start.x += 1;
+    EXPECT_NE(font.glyph(U'\uac00').hash(), glyph_hash);
+    EXPECT_NE(font.hash(), hash);
+    EXPECT_FALSE(font == copy);
+
+    font.table<geul::HmtxTable>()->metrics[0].advance_width += 1;
+
+    auto diff = font.diff(copy);
+    EXPECT_EQ(diff.tables, (std::vector<std::string>{ "CFF ", "hmtx" }));
+    EXPECT_EQ(diff.glyphs, std::vector<std::size_t>{ gid });
+
+    // and changing it back restores them
+    font.glyph(U'\uac00').paths[0].start.x -= 1;
+    font.table<geul::HmtxTable>()->metrics[0].advance_width -= 1;
+    EXPECT_EQ(font.hash(), hash);
+    EXPECT_TRUE(font == copy);
+
+    // as do tables hashed by their compiled bytes
+    auto os2 = font.table<geul::OS2Table>();
+    os2->us_weight_class += 100;
+    EXPECT_NE(font.hash(), hash);
+    EXPECT_EQ(font.diff(copy).tables, std::vector<std::string>{ "OS/2" });
+    os2->us_weight_class -= 100;
+    font.invalidate_hash();
+    EXPECT_EQ(font.hash(), hash);
+
+    font.table<geul::NameTable>()->records[0].str += "x";
+    EXPECT_NE(font.hash(), hash);
+    EXPECT_EQ(font.diff(copy).tables, std::vector<std::string>{ "name" });
+}
+
+TEST(geul, subroutinize)
+{
+    // glyphs made of ever longer runs of the same segments, in 2 font dicts
+    std::vector<geul::Glyph> glyphs;
+    std::vector<std::string> charstrings;
+    std::vector<uint8_t>     fd_select;
+    std::size_t              plain_size = 0;
+    for (int i = 0; i < 40; ++i)
+    {
+        geul::Point p{ i, 0 };
+        geul::Path  path(p);
+        for (int j = 0; j < 4 * i; ++j)
+        {
+            if (j % 3 == 2)
+            {
+                path.curveto(
+                    { p.x + 5, p.y }, { p.x + 10, p.y + 5 }, { p.x, p.y + 9 });
+                p.y += 9;
+            }
+            else
+            {
+                p = { p.x + 10, p.y + 7 * (j % 3) - 7 };
+                path.lineto(p);
+            }
+        }
+        geul::Glyph glyph;
+        glyph.paths.push_back(path);
+        glyph.width = 0;
+        glyphs.push_back(glyph);
+
+        geul::OutputBuffer out;
+        geul::write_charstring(out, glyphs.back());
+        auto span = out.view().span();
+        charstrings.emplace_back(span.data, span.size);
+        fd_select.push_back(i % 2);
+        plain_size += span.size;
+    }
+
+    auto subrs = geul::find_subroutines(charstrings, fd_select, 2);
+    ASSERT_EQ(subrs.charstrings.size(), charstrings.size());
+    ASSERT_EQ(subrs.lsubrs.size(), 2u);
+
+    std::size_t size = 0;
+    for (auto const& cs : subrs.charstrings)
+        size += cs.size();
+    for (auto const& subr : subrs.gsubrs)
+        size += subr.size();
+    for (auto const& lsubrs : subrs.lsubrs)
+        for (auto const& subr : lsubrs)
+            size += subr.size();
+    EXPECT_LT(size, plain_size / 2);
+    EXPECT_FALSE(subrs.gsubrs.empty());
+
+    // the parser rejects biased numbers out of range and deep nesting
+    for (auto i = 0u; i < glyphs.size(); ++i)
+    {
+        geul::ParseError error;
+        auto             glyph = geul::parse_charstring(
+            subrs.charstrings[i],
+            subrs.gsubrs,
+            subrs.lsubrs[fd_select[i]],
+            0,
+            0,
+            &error);
+        EXPECT_FALSE(error) << error.message;
+        EXPECT_EQ(glyph, glyphs[i]);
+    }
+
+    // the same subroutines on any number of threads
+    auto parallel = geul::find_subroutines(charstrings, fd_select, 2, 4);
+    EXPECT_EQ(parallel.charstrings, subrs.charstrings);
+    EXPECT_EQ(parallel.gsubrs, subrs.gsubrs);
+    EXPECT_EQ(parallel.lsubrs, subrs.lsubrs);
+
+    // charstrings already calling subroutines are rejected
+    std::vector<std::string> calling = { std::string("\x8b\x0a\x0e", 3) };
+    EXPECT_THROW(
+        geul::find_subroutines(calling, {}, 1), std::runtime_error);
+
+    // a whole font, encoded again, shrinks and reads back the same
+    auto font = parse_all("data/SourceHanSansKR-Regular.otf");
+    auto cff = font.table<geul::CFFTable>();
+    cff->keep_charstrings = false;
+    geul::OutputBuffer plain, packed;
+    cff->subroutinize = false;
+    cff->compile(plain);
+    cff->subroutinize = true;
+    cff->compile(packed);
+    EXPECT_LT(packed.size(), plain.size());
+
+    geul::CFFTable copy;
+    auto           view = packed.view();
+    copy.parse(view);
+    EXPECT_TRUE(copy == *cff);
+}
+
+TEST(geul, lazy_glyphs)
+{
+    auto font = geul::parse_otf("data/NotoSansCJKkr-Regular.otf");
+    auto cff = font.table<geul::CFFTable>();
+    auto cmap = font.table<geul::CmapTable>();
+    auto& glyphs = cff->fonts[0].glyphs;
+    auto  gid = cmap->gid(U'\uAC00');
+    auto  other = cmap->gid(U'\uAC01');
+
+    // read glyphs are decoded once and kept while they are recent
+    auto glyph = glyphs.get(gid);
+    EXPECT_EQ(glyphs.get(gid), glyph);
+    glyphs.set_cache_size(1);
+    glyphs.get(other);
+    EXPECT_NE(glyphs.get(gid), glyph);
+    EXPECT_EQ(*glyphs.get(gid), *glyph);
+    EXPECT_FALSE(glyphs.edited(gid));
+    EXPECT_THROW(glyphs.get(glyphs.size()), std::out_of_range);
+
+    // only edited glyphs are encoded again
+    geul::OutputBuffer out;
+    cff->compile(out);
+    geul::CFFTable copy;
+    auto           view = out.view();
+    copy.parse(view);
+    EXPECT_EQ(
+        copy.fonts[0].glyphs.charstring(other),
+        glyphs.charstring(other));
+
+    // glyphs handed out for editing are copied until their paths change
+    auto original = glyphs.charstring(gid);
+    glyphs.at(gid);
+    EXPECT_TRUE(glyphs.edited(gid));
+    EXPECT_FALSE(glyphs.dirty(gid));
+    EXPECT_EQ(glyphs.charstring(gid), original);
+
+    auto edited = glyphs.get(gid);
+    glyphs.at(gid).paths[0].start.x += 1;
+    EXPECT_EQ(edited->paths[0].start.x, glyph->paths[0].start.x + 1);
+    EXPECT_TRUE(glyphs.dirty(gid));
+    EXPECT_EQ(glyphs.charstring(gid).size, 0u);
+    EXPECT_FALSE(*glyphs.get(gid) == *glyph);
+    EXPECT_FALSE(copy == *cff);
+
+    out = geul::OutputBuffer();
+    cff->compile(out);
+    view = out.view();
+    copy.parse(view);
+    EXPECT_TRUE(copy == *cff);
+    EXPECT_EQ(
+        copy.fonts[0].glyphs.charstring(other),
+        glyphs.charstring(other));
+
+    // and are copied again once they are changed back
+    glyphs.at(gid).paths[0].start.x -= 1;
+    EXPECT_FALSE(glyphs.dirty(gid));
+    out = geul::OutputBuffer();
+    cff->compile(out);
+    view = out.view();
+    copy.parse(view);
+    EXPECT_EQ(copy.fonts[0].glyphs.charstring(gid), original);
+
+    // a new width alone is encoded too, and survives a save and reload
+    auto width = glyphs.get(gid)->width;
+    glyphs.at(gid).width = width + 37;
+    EXPECT_TRUE(glyphs.dirty(gid));
+    EXPECT_EQ(
+        copy.fonts[0].glyphs.differences(glyphs),
+        std::vector<std::size_t>{ gid });
+    geul::write_otf(font, "out.otf");
+    auto reloaded = geul::parse_otf("out.otf");
+    auto const& reloaded_glyphs
+        = reloaded.table<geul::CFFTable>()->fonts[0].glyphs;
+    EXPECT_EQ(reloaded_glyphs.get(gid)->width, width + 37);
+    EXPECT_EQ(reloaded_glyphs.get(other)->width, glyphs.get(other)->width);
+
+    // edited glyphs read outlive the glyphs they were read from
+    edited = glyphs.get(gid);
+    glyphs.resize(gid);
+    EXPECT_EQ(edited->width, width + 37);
+    {
+        auto copy = glyphs;
+        copy.push_back(*edited);
+        edited = copy.get(gid);
+    }
+    EXPECT_EQ(edited->width, width + 37);
+}
+
+TEST(geul, decode_glyphs)
+{
+    auto buf = geul::InputBuffer::map("data/NotoSansCJKkr-Regular.otf");
+    auto dis = table_bytes(buf.view(), "CFF ");
+
+    geul::CFFTable cff;
+    cff.parse(dis);
+    auto const& glyphs = cff.fonts[0].glyphs;
+
+    auto decoded = glyphs;
+    decoded.decode_all(4);
+    EXPECT_GE(decoded.cache_size(), decoded.size());
+    for (auto gid = 0u; gid < glyphs.size(); gid += 97)
+        EXPECT_EQ(*decoded.get(gid), *glyphs.get(gid));
+
+    // the error of the lowest malformed glyph, on any number of threads
+    auto offset = [&](std::size_t gid) {
+        return std::size_t(
+            glyphs.charstring(gid).data - glyphs.source()->data.data.get());
+    };
+    auto bytes = dis.span().str();
+    bytes[offset(3000)] = 5; // rlineto as the first operator
+    bytes[offset(1000)] = 5;
+
+    geul::CFFTable bad;
+    auto           bad_dis = geul::BufferView(bytes.data(), bytes.size());
+    bad.parse(bad_dis);
+    for (auto num_threads : { 1u, 4u })
+    {
+        auto             bad_glyphs = bad.fonts[0].glyphs;
+        geul::ParseError error;
+        bad_glyphs.decode_all(num_threads, &error);
+        EXPECT_EQ(error.code, geul::ParseError::Code::bad_charstring);
+        EXPECT_EQ(error.offset, offset(1000));
+        EXPECT_THROW(bad_glyphs.decode_all(num_threads), std::runtime_error);
+
+        // and validating finds the same without keeping any glyph
+        error = geul::ParseError();
+        bad.fonts[0].glyphs.validate(num_threads, &error);
+        EXPECT_EQ(error.offset, offset(1000));
+        EXPECT_EQ(
+            bad.fonts[0].glyphs.cache_size(),
+            geul::CFFGlyphs::default_cache_size);
+    }
+
+    // parsing the whole font without throwing decodes every charstring,
+    // and keeps none of them
+    auto valid = geul::try_parse_otf(buf.view().span());
+    ASSERT_TRUE(valid);
+    EXPECT_EQ(
+        valid->table<geul::CFFTable>()->fonts[0].glyphs.cache_size(),
+        geul::CFFGlyphs::default_cache_size);
+
+    auto font_bytes = buf.view().span().str();
+    auto cff_offset = dis.span().data - buf.view().span().data;
+    font_bytes[cff_offset + offset(1000)] = 5;
+    geul::ParseOptions options;
+    options.checksums = geul::ParseOptions::Checksums::skip;
+    auto result = geul::try_parse_otf(
+        geul::ByteSpan{ font_bytes.data(), font_bytes.size() }, options);
+    ASSERT_FALSE(result);
+    EXPECT_EQ(result.error().code, geul::ParseError::Code::bad_charstring);
+    EXPECT_EQ(result.error().tag, "CFF ");
+    EXPECT_EQ(result.error().offset, cff_offset + offset(1000));
+}
+
+TEST(geul, encode_charstrings)
+{
+    // offsets as wide as the data needs, items copied back to back
+    std::string        bytes = "abcde" + std::string(300, 'x');
+    geul::OutputBuffer out;
+    geul::write_index(
+        out,
+        { { bytes.data(), 2 }, { bytes.data() + 2, 0 }, { "cde", 3 } });
+    EXPECT_EQ(
+        out.view().span().str(),
+        std::string("\x00\x03\x01\x01\x03\x03\x06" "abcde", 12));
+    out = geul::OutputBuffer();
+    geul::write_index(out, { { bytes.data(), bytes.size() } });
+    EXPECT_EQ(
+        out.view().span().str().substr(0, 7),
+        std::string("\x00\x01\x02\x00\x01\x01\x32", 7));
+
+    // edited glyphs are encoded alike on any number of threads, and the
+    // others are copied
+    auto font = parse_all("data/SourceHanSansKR-Regular.otf");
+    auto cff = font.table<geul::CFFTable>();
+    auto& glyphs = cff->fonts[0].glyphs;
+    for (auto gid = 0u; gid < glyphs.size(); gid += 2)
+    {
+        auto& glyph = glyphs.at(gid);
+        if (!glyph.paths.empty())
+            glyph.paths[0].start.x += 1;
+    }
+
+    geul::OutputBuffer serial, parallel;
+    cff->compile(serial);
+    cff->num_threads = 4;
+    cff->compile(parallel);
+    EXPECT_EQ(parallel.view().span().str(), serial.view().span().str());
+
+    geul::CFFTable copy;
+    auto           view = parallel.view();
+    copy.parse(view);
+    EXPECT_TRUE(copy == *cff);
+    EXPECT_EQ(copy.fonts[0].glyphs.charstring(1), glyphs.charstring(1));
+}
+
+TEST(geul, charstring_operands)
+{
+    // 16.16 fixed operands keep their fraction until points are rounded
+    std::string cs(
+        "\xff\x00\x01\x80\x00\x8d\x15"
+        "\xff\x00\x01\x80\x00\x8b\x05"
+        "\x1c\xff\x38\x8b\x05\x0e",
+        20);
+    geul::Path path({ 2, 2 });
+    path.lineto({ 3, 2 });
+    path.lineto({ -197, 2 });
+    geul::Glyph expected;
+    expected.paths.push_back(path);
+    expected.width = 500;
+    EXPECT_EQ(geul::parse_charstring(cs, {}, {}, 500, 0), expected);
+
+    // the stack holds 48 operands and no more
+    auto glyph = geul::parse_charstring(
+        "\x8b\x8b\x15" + std::string(48, '\x8c') + "\x05\x0e", {}, {}, 0, 0);
+    ASSERT_EQ(glyph.paths.size(), 1u);
+    EXPECT_EQ(glyph.paths[0].segments.size(), 24u);
+
+    geul::ParseError error;
+    geul::parse_charstring(
+        "\x8b\x8b\x15" + std::string(49, '\x8c') + "\x05\x0e",
+        {},
+        {},
+        0,
+        0,
+        &error);
+    EXPECT_EQ(error.code, geul::ParseError::Code::bad_charstring);
+
+    // charstrings that run out are out of bounds
+    error = geul::ParseError();
+    geul::parse_charstring(
+        std::string("\x8b\x8b\x15\x1c\x01", 5), {}, {}, 0, 0, &error);
+    EXPECT_EQ(error.code, geul::ParseError::Code::out_of_bounds);
+}
+
+TEST(geul, charstring_encoder)
+{
+    // lines along the axes alternate in one operator, and the width is
+    // left out when it is the default
+    geul::Glyph glyph;
+    glyph.paths.push_back(geul::Path({ 10, 0 }));
+    glyph.paths[0].lineto({ 100, 0 });
+    glyph.paths[0].lineto({ 100, 100 });
+    glyph.paths[0].lineto({ 10, 100 });
+    glyph.width = 500;
+    geul::OutputBuffer out;
+    geul::write_charstring(out, glyph, 500, 0);
+    EXPECT_EQ(out.view().span().str(), "\x95\x16\xe5\xef\x31\x06\x0e");
+
+    out = geul::OutputBuffer();
+    glyph.width = 600;
+    geul::write_charstring(out, glyph, 500, 500);
+    auto cs = out.view().span().str();
+    EXPECT_EQ(cs, "\xef\x95\x16\xe5\xef\x31\x06\x0e");
+    EXPECT_EQ(geul::parse_charstring(cs, {}, {}, 500, 500).width, 600);
+
+    // runs of every shape read back the same, and are shorter than one
+    // operator per segment
+    uint32_t seed = 1;
+    auto     next = [&](int range) {
+        seed = seed * 1103515245 + 12345;
+        return int(seed >> 16) % range;
+    };
+    auto coord = [&] {
+        int kind = next(4);
+        return kind == 0 ? 0 : kind == 1 ? next(200) - 100 : next(4000) - 2000;
+    };
+    glyph = geul::Glyph();
+    geul::Point pos = { 0, 0 };
+    std::size_t plain = 1;
+    for (int i = 0; i < 3; ++i)
+    {
+        pos = { pos.x + coord(), pos.y + coord() };
+        glyph.paths.push_back(geul::Path(pos));
+        plain += 7;
+        for (int j = 0; j < 300; ++j)
+        {
+            if (next(2))
+            {
+                pos = { pos.x + coord(), pos.y + coord() };
+                glyph.paths.back().lineto(pos);
+                plain += 7;
+                continue;
+            }
+            geul::Point ct1 = { pos.x + coord(), pos.y + coord() };
+            geul::Point ct2 = { ct1.x + coord(), ct1.y + coord() };
+            pos = { ct2.x + coord(), ct2.y + coord() };
+            if (ct1 == ct2 && ct2 == pos)
+                ct1.x += 1;
+            glyph.paths.back().curveto(ct1, ct2, pos);
+            plain += 19;
+        }
+    }
+    glyph.width = 0;
+
+    out = geul::OutputBuffer();
+    geul::write_charstring(out, glyph);
+    geul::ParseError error;
+    auto             decoded = geul::parse_charstring(
+        out.view().span().str(), {}, {}, 0, 0, &error);
+    EXPECT_FALSE(error) << error.message;
+    EXPECT_EQ(decoded, glyph);
+    EXPECT_LT(out.size(), plain);
+}
+
+TEST(geul, random_access_index)
+{
+    // items of each offset size are found without walking the INDEX
+    for (std::size_t size : { 10, 300, 70000, 20000000 })
+    {
+        std::string        bytes(size, 'x');
+        geul::OutputBuffer out;
+        out.write<uint8_t>(0xaa);
+        geul::write_index(
+            out,
+            { { "ab", 2 },
+              { bytes.data(), bytes.size() },
+              { "", 0 },
+              { "cde", 3 } });
+        out.write<uint8_t>(0xbb);
+
+        auto view = out.view();
+        view.seek(1);
+        auto index = geul::parse_index(view);
+        EXPECT_EQ(view.read<uint8_t>(), 0xbb);
+        ASSERT_EQ(index.size(), 4u);
+        EXPECT_EQ(index.span(3).str(), "cde");
+        EXPECT_EQ(index.span(0).str(), "ab");
+        EXPECT_EQ(index.span(1).size, size);
+        EXPECT_EQ(index.span(2).size, 0u);
+        EXPECT_EQ(index[3].index, 3u);
+        EXPECT_EQ(index[3].length, 3u);
+        EXPECT_EQ(view.at(index[3].pos).read_string(3), "cde");
+
+        std::size_t count = 0;
+        for (auto item : index)
+            EXPECT_EQ(item.index, count++);
+        EXPECT_EQ(count, 4u);
+    }
+
+    // offsets out of order or past the end are rejected
+    for (auto bytes : { std::string("\x00\x02\x01\x01\x03\x02" "ab", 8),
+                        std::string("\x00\x01\x01\x01\x04" "ab", 7) })
+    {
+        geul::ParseError error;
+        auto view = geul::BufferView(bytes.data(), bytes.size())
+                        .report_to(&error);
+        auto index = geul::parse_index(view);
+        EXPECT_TRUE(error);
+        EXPECT_EQ(index.size(), 0u);
+    }
+}
+
 #if 0
 TEST(open_file, ttx)
 {